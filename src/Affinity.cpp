@@ -0,0 +1,337 @@
+#include "Affinity.h"
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QStringList>
+#include <algorithm>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char *const PolicyNames[] = {
+    "default", "other", "batch", "idle", "fifo", "rr",
+};
+
+static std::optional<SchedulingPolicy> policyFromName(const QString &name) {
+    for (int i = 0; i < int(std::size(PolicyNames)); i++) {
+        if (name == PolicyNames[i]) {
+            return static_cast<SchedulingPolicy>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+static bool isRealTime(SchedulingPolicy policy) {
+    return policy == SchedulingPolicy::Fifo ||
+           policy == SchedulingPolicy::RoundRobin;
+}
+
+bool ThreadPlacement::isDefault() const {
+    return cpus.empty() && policy == SchedulingPolicy::Default && !nice;
+}
+
+QString ThreadPlacement::toString() const {
+    QStringList parts;
+    if (!cpus.empty()) {
+        auto text = QString("cpus %1").arg(formatCpuList(cpus));
+        if (!numaNodes.empty()) {
+            text += QString(" (node %1)").arg(formatCpuList(numaNodes));
+        }
+        if (pinWorkers) {
+            text += ", one per worker";
+        }
+        parts.append(text);
+    }
+    if (policy != SchedulingPolicy::Default) {
+        auto text = QString(PolicyNames[int(policy)]);
+        if (isRealTime(policy)) {
+            text += QString(" %1").arg(priority);
+        }
+        parts.append(text);
+    }
+    if (nice) {
+        parts.append(QString("nice %1").arg(*nice));
+    }
+    return parts.isEmpty() ? QString("default") : parts.join(", ");
+}
+
+void addAffinityOptions(QCommandLineParser &parser) {
+    parser.addOptions({
+        {"cpus",
+         "Run the threads which sort on these CPUs, e.g. 2-3, and keep the "
+         "window off them",
+         "list"},
+        {"numa-nodes", "Run the threads which sort on the CPUs of these NUMA "
+                       "nodes, e.g. 1",
+         "list"},
+        {"sched-policy",
+         "Scheduling policy of the threads which sort: other, batch, idle, "
+         "fifo or rr",
+         "policy", "default"},
+        {"sched-priority", "Priority for the fifo and rr policies",
+         "priority", "1"},
+        {"nice", "Nice level of the threads which sort", "level"},
+        {"pin-workers",
+         "Pin each worker of --tests to one CPU of --cpus or --numa-nodes"},
+    });
+}
+
+static std::optional<std::vector<int>> readCpuList(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return std::nullopt;
+    }
+    return parseCpuList(QString::fromUtf8(file.readAll()).trimmed());
+}
+
+static std::optional<std::vector<int>> nodeCpus(int node) {
+    return readCpuList(
+        QString("/sys/devices/system/node/node%1/cpulist").arg(node));
+}
+
+std::optional<ThreadPlacement>
+parseThreadPlacement(const QCommandLineParser &parser) {
+    ThreadPlacement placement;
+
+    if (parser.isSet("cpus")) {
+        const auto cpus = parseCpuList(parser.value("cpus"));
+        if (!cpus || cpus->empty()) {
+            fprintf(stderr, "Invalid CPU list: %s\n",
+                    qPrintable(parser.value("cpus")));
+            return std::nullopt;
+        }
+        placement.cpus = *cpus;
+    }
+
+    if (parser.isSet("numa-nodes")) {
+        const auto nodes = parseCpuList(parser.value("numa-nodes"));
+        if (!nodes || nodes->empty()) {
+            fprintf(stderr, "Invalid NUMA node list: %s\n",
+                    qPrintable(parser.value("numa-nodes")));
+            return std::nullopt;
+        }
+        std::vector<int> cpus;
+        for (int node : *nodes) {
+            const auto ofNode = nodeCpus(node);
+            if (!ofNode) {
+                fprintf(stderr, "No NUMA node %d\n", node);
+                return std::nullopt;
+            }
+            cpus.insert(cpus.end(), ofNode->begin(), ofNode->end());
+        }
+        // Both restrict the CPUs.
+        if (!placement.cpus.empty()) {
+            std::erase_if(cpus, [&](int cpu) {
+                return !std::binary_search(placement.cpus.begin(),
+                                           placement.cpus.end(), cpu);
+            });
+        }
+        std::sort(cpus.begin(), cpus.end());
+        if (cpus.empty()) {
+            fprintf(stderr, "No CPUs of --cpus on --numa-nodes\n");
+            return std::nullopt;
+        }
+        placement.cpus = cpus;
+        placement.numaNodes = *nodes;
+    }
+
+    const auto policy = policyFromName(parser.value("sched-policy"));
+    if (!policy) {
+        fprintf(stderr, "Invalid scheduling policy: %s\n",
+                qPrintable(parser.value("sched-policy")));
+        return std::nullopt;
+    }
+    placement.policy = *policy;
+
+    bool ok;
+    placement.priority = parser.value("sched-priority").toInt(&ok);
+    if (!ok) {
+        fprintf(stderr, "Invalid priority: %s\n",
+                qPrintable(parser.value("sched-priority")));
+        return std::nullopt;
+    }
+
+    if (parser.isSet("nice")) {
+        placement.nice = parser.value("nice").toInt(&ok);
+        if (!ok) {
+            fprintf(stderr, "Invalid nice level: %s\n",
+                    qPrintable(parser.value("nice")));
+            return std::nullopt;
+        }
+    }
+
+    placement.pinWorkers = parser.isSet("pin-workers");
+    if (placement.pinWorkers && placement.cpus.empty()) {
+        fprintf(stderr, "--pin-workers needs --cpus or --numa-nodes\n");
+        return std::nullopt;
+    }
+
+    return placement;
+}
+
+static ThreadPlacement &placement() {
+    static ThreadPlacement placement;
+    return placement;
+}
+
+const ThreadPlacement &threadPlacement() { return placement(); }
+
+void setThreadPlacement(ThreadPlacement p) { placement() = std::move(p); }
+
+std::optional<std::vector<int>> parseCpuList(const QString &text) {
+    std::vector<int> cpus;
+    if (text.isEmpty()) {
+        return cpus;
+    }
+    for (const auto &range : text.split(',')) {
+        const auto bounds = range.split('-');
+        bool ok = bounds.size() <= 2;
+        const int first = ok ? bounds[0].toInt(&ok) : 0;
+        int last = first;
+        if (ok && bounds.size() == 2) {
+            last = bounds[1].toInt(&ok);
+        }
+        if (!ok || first < 0 || last < first) {
+            return std::nullopt;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+QString formatCpuList(const std::vector<int> &cpus) {
+    QStringList ranges;
+    for (std::size_t begin = 0, end; begin < cpus.size(); begin = end) {
+        for (end = begin + 1;
+             end < cpus.size() && cpus[end] == cpus[end - 1] + 1; end++) {
+        }
+        ranges.append(end - begin == 1
+                          ? QString::number(cpus[begin])
+                          : QString("%1-%2").arg(cpus[begin]).arg(
+                                cpus[end - 1]));
+    }
+    return ranges.join(",");
+}
+
+QString describeTopology() {
+    const auto online = readCpuList("/sys/devices/system/cpu/online");
+    if (!online) {
+        return "unknown";
+    }
+    auto text = QString("cpus %1").arg(formatCpuList(*online));
+    if (const auto nodes = readCpuList("/sys/devices/system/node/online");
+        nodes && nodes->size() > 1) {
+        QStringList parts;
+        for (int node : *nodes) {
+            const auto cpus = nodeCpus(node);
+            parts.append(QString("%1: %2").arg(node).arg(
+                cpus ? formatCpuList(*cpus) : QString("?")));
+        }
+        text += QString(", nodes %1").arg(parts.join(", "));
+    }
+    return text;
+}
+
+#ifdef __linux__
+
+static QString errorString(const char *function) {
+    return QString("%1: %2").arg(function, strerror(errno));
+}
+
+static QString setAffinity(const cpu_set_t &set) {
+    if (sched_setaffinity(0 /* this thread */, sizeof(set), &set)) {
+        return errorString("sched_setaffinity");
+    }
+    return {};
+}
+
+static QString setCpus(const std::vector<int> &cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return setAffinity(set);
+}
+
+QString applyToCurrentThread(const ThreadPlacement &placement) {
+    if (!placement.cpus.empty()) {
+        if (auto error = setCpus(placement.cpus); !error.isEmpty()) {
+            return error;
+        }
+    }
+
+    if (placement.policy != SchedulingPolicy::Default) {
+        constexpr int Policies[] = {
+            SCHED_OTHER, SCHED_OTHER, SCHED_BATCH,
+            SCHED_IDLE,  SCHED_FIFO,  SCHED_RR,
+        };
+        sched_param param{};
+        param.sched_priority =
+            isRealTime(placement.policy) ? placement.priority : 0;
+        if (int error = pthread_setschedparam(
+                pthread_self(), Policies[int(placement.policy)], &param)) {
+            errno = error;
+            return errorString("pthread_setschedparam");
+        }
+    }
+
+    // The nice level is per thread on Linux.
+    if (placement.nice &&
+        setpriority(PRIO_PROCESS, syscall(SYS_gettid), *placement.nice)) {
+        return errorString("setpriority");
+    }
+
+    return {};
+}
+
+QString pinCurrentThread(int cpu) { return setCpus({cpu}); }
+
+QString excludeCurrentThread(const ThreadPlacement &placement) {
+    if (placement.cpus.empty()) {
+        return {};
+    }
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set)) {
+        return errorString("sched_getaffinity");
+    }
+    for (int cpu : placement.cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_CLR(cpu, &set);
+        }
+    }
+    if (CPU_COUNT(&set) == 0) {
+        return "No CPUs left besides those of --cpus";
+    }
+    return setAffinity(set);
+}
+
+#else
+
+static const QString Unsupported =
+    "Thread placement is only supported on Linux";
+
+QString applyToCurrentThread(const ThreadPlacement &placement) {
+    return placement.isDefault() ? QString() : Unsupported;
+}
+
+QString pinCurrentThread(int) { return Unsupported; }
+
+QString excludeCurrentThread(const ThreadPlacement &placement) {
+    return placement.cpus.empty() ? QString() : Unsupported;
+}
+
+#endif
@@ -0,0 +1,66 @@
+/* -*- mode: c++; -*- */
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <QString>
+#include <optional>
+#include <vector>
+
+class QCommandLineParser;
+
+enum class SchedulingPolicy {
+    // Whatever the threads inherited.
+    Default,
+    Other,
+    Batch,
+    Idle,
+    Fifo,
+    RoundRobin,
+};
+
+// Where and how the threads which sort run, so that timings on shared
+// or many-core hosts don't depend on where the scheduler put them.
+// Threads inherit the placement of the thread which starts them, so
+// the workers of parallel algorithms share its CPUs.
+struct ThreadPlacement {
+    // Any CPU if empty.
+    std::vector<int> cpus;
+    // The NUMA nodes the CPUs were given as, if any.
+    std::vector<int> numaNodes;
+    SchedulingPolicy policy = SchedulingPolicy::Default;
+    // For the real-time policies.
+    int priority = 1;
+    std::optional<int> nice;
+    // Pin each worker of --tests to one of the CPUs.
+    bool pinWorkers = false;
+
+    bool isDefault() const;
+    // E.g. "cpus 4-7 (node 1), fifo 10, nice -5".
+    QString toString() const;
+};
+
+void addAffinityOptions(QCommandLineParser &);
+std::optional<ThreadPlacement> parseThreadPlacement(const QCommandLineParser &);
+
+// The placement given on the command line, which sorting threads apply
+// to themselves.
+const ThreadPlacement &threadPlacement();
+void setThreadPlacement(ThreadPlacement);
+
+// Apply to the calling thread, and return an error message if they
+// failed.  excludeCurrentThread() keeps the thread off the CPUs of the
+// placement, e.g. the GUI thread, so that it doesn't compete with the
+// sorting thread.
+QString applyToCurrentThread(const ThreadPlacement &);
+QString pinCurrentThread(int cpu);
+QString excludeCurrentThread(const ThreadPlacement &);
+
+// The CPUs and NUMA nodes of the host, e.g. "cpus 0-7, nodes 0: 0-3,
+// 1: 4-7", to record with results.
+QString describeTopology();
+
+// Parses and formats lists such as "0-3,8,10-11".
+std::optional<std::vector<int>> parseCpuList(const QString &);
+QString formatCpuList(const std::vector<int> &);
+
+#endif
@@ -1,7 +1,11 @@
 #include "Algorithms.h"
+#include "Auto.h"
+#include "Select.h"
 #include "SortItem.h"
+#include "VectorSort.h"
+#include "WikiSort.h"
 #include <algorithm>
-#include <set>
+#include <cmath>
 
 #ifdef HAVE_BOOST
 #include <boost/sort/sort.hpp>
@@ -13,19 +17,21 @@ template <typename It> static void merge(const It, const It, const It);
 
 template <typename It> static void quickSortImpl(It begin, It end);
 
+struct RadixBucket {
+    std::vector<SortItem> items;
+    std::optional<AuxBuffer> auxBuffer;
+};
+
 template <typename It>
-static void RadixSortMSDImpl(std::vector<int>::iterator beginBucket,
-                             std::vector<int>::iterator endBucket, It out,
-                             int digit, const int maxDigit,
-                             const int numBuckets);
+static std::vector<RadixBucket> distribute(It begin, It end, int digit,
+                                           const int numBuckets);
+template <typename It>
+static void concatenateBuckets(std::vector<RadixBucket> &buckets, It out);
 template <typename It>
-static void RadixSortLSDImpl(std::vector<int>::iterator beginBucket,
-                             std::vector<int>::iterator endBucket, It out,
-                             int digit, const int maxDigit,
+static void RadixSortMSDImpl(It begin, It end, int digit, const int maxDigit,
                              const int numBuckets);
-namespace Wiki {
-void Sort(std::vector<SortItem> &vec);
-}
+static int maxRadixDigit(const std::vector<SortItem> &vec,
+                         const int numBuckets);
 
 void QuickSort(std::vector<SortItem> &vec) {
     quickSortImpl(vec.begin(), vec.end());
@@ -50,10 +56,9 @@ void MergeSortStdMerge(std::vector<SortItem> &vec) {
                       using T = std::decay_t<decltype(*first)>;
                       std::vector<T> temp;
                       temp.resize(last - first);
+                      AuxBuffer auxBuffer(temp);
                       std::merge(first, middle, middle, last, temp.begin());
-                      for (auto &v : temp) {
-                          *first++ = v;
-                      }
+                      moveItems(temp.begin(), temp.end(), first);
                   });
 }
 
@@ -69,6 +74,24 @@ void BottomUpMergeSort(std::vector<SortItem> &vec) {
     }
 }
 
+template <Wiki::CacheKind Kind> void WikiSort(std::vector<SortItem> &vec) {
+    Wiki::Sort(vec, {.kind = Kind});
+}
+
+Algorithm WikiSortWithBudget(std::size_t bytes) {
+    return {
+        .name = QString("WikiSort (%1 byte cache)").arg(bytes),
+        .function =
+            [bytes](std::vector<SortItem> &vec) {
+                Wiki::Sort(vec, {.kind = Wiki::CacheKind::Budget,
+                                 .budgetBytes = bytes});
+            },
+        .stable = true,
+        .inPlace = true,
+        .auxMemory = AuxMemory::Constant,
+    };
+}
+
 void StdSort(std::vector<SortItem> &vec) { std::sort(vec.begin(), vec.end()); }
 
 void StdStableSort(std::vector<SortItem> &vec) {
@@ -93,8 +116,11 @@ void BoostSpinSort(std::vector<SortItem> &vec) {
     boost::sort::spinsort(vec.begin(), vec.end());
 }
 
+// flat_stable_sort() fails an assertion on empty ranges.
 void BoostFlatStableSort(std::vector<SortItem> &vec) {
-    boost::sort::flat_stable_sort(vec.begin(), vec.end());
+    if (!vec.empty()) {
+        boost::sort::flat_stable_sort(vec.begin(), vec.end());
+    }
 }
 #endif
 
@@ -105,12 +131,12 @@ void ShellSort(std::vector<SortItem> &vec) {
 
     for (auto gap : gaps) {
         for (unsigned int i = gap; i < vec.size(); i++) {
-            auto temp = vec[i];
+            auto temp = std::move(vec[i]);
             unsigned int j;
             for (j = i; (j >= gap) && vec[j - gap] > temp; j -= gap) {
-                vec[j] = vec[j - gap];
+                vec[j] = std::move(vec[j - gap]);
             }
-            vec[j] = temp;
+            vec[j] = std::move(temp);
         }
     }
 }
@@ -175,23 +201,20 @@ void CocktailSort(std::vector<SortItem> &vec) {
 void RadixSortMSD(std::vector<SortItem> &vec) {
     constexpr int numBuckets = 10;
 
-    std::vector<int> values(vec.begin(), vec.end());
-    const int max = *std::max_element(vec.begin(), vec.end());
-    const int maxDigit = 1 + std::log(max) / std::log(numBuckets);
+    const int maxDigit = maxRadixDigit(vec, numBuckets);
 
-    RadixSortMSDImpl(values.begin(), values.end(), vec.begin(), 0, maxDigit,
-                     numBuckets);
+    RadixSortMSDImpl(vec.begin(), vec.end(), 0, maxDigit, numBuckets);
 }
 
 void RadixSortLSD(std::vector<SortItem> &vec) {
     constexpr int numBuckets = 10;
 
-    std::vector<int> values(vec.begin(), vec.end());
-    const int max = *std::max_element(vec.begin(), vec.end());
-    const int maxDigit = 1 + std::log(max) / std::log(numBuckets);
+    const int maxDigit = maxRadixDigit(vec, numBuckets);
 
-    RadixSortLSDImpl(values.begin(), values.end(), vec.begin(), 0, maxDigit,
-                     numBuckets);
+    for (int digit = 0; digit <= maxDigit; digit++) {
+        auto buckets = distribute(vec.begin(), vec.end(), digit, numBuckets);
+        concatenateBuckets(buckets, vec.begin());
+    }
 }
 
 template <typename It> static auto &choosePivot(It begin, It end) {
@@ -240,26 +263,27 @@ static void merge(const It first, const It middle, const It last) {
 
     using T = std::decay_t<decltype(*first)>;
 
-    std::vector<T> temp;
+    std::vector<T> temp(last - first);
+    AuxBuffer auxBuffer(temp);
+    auto out = temp.begin();
 
+    // The items are overwritten when moved back, so they are moved
+    // both ways.
     while (begFirst != endFirst && begSecond != endSecond) {
         if (*begFirst <= *begSecond) {
-            temp.emplace_back(*begFirst++);
+            *out++ = std::move(*begFirst++);
         } else {
-            temp.emplace_back(*begSecond++);
+            *out++ = std::move(*begSecond++);
         }
     }
     while (begFirst != endFirst) {
-        temp.emplace_back(*begFirst++);
+        *out++ = std::move(*begFirst++);
     }
     while (begSecond != endSecond) {
-        temp.emplace_back(*begSecond++);
+        *out++ = std::move(*begSecond++);
     }
 
-    auto it = first;
-    for (auto &v : temp) {
-        *it++ = v;
-    }
+    moveItems(temp.begin(), temp.end(), first);
 }
 
 template <typename It, typename MergeFn>
@@ -284,172 +308,431 @@ static int LSDigit(int val, int digit, const int base) {
     return val % base;
 }
 
-// Simply copies bucket contents, in order, to the provided output
+// Index of the most significant digit of the largest item.
+static int maxRadixDigit(const std::vector<SortItem> &vec,
+                         const int numBuckets) {
+    if (vec.empty()) {
+        return 0;
+    }
+    int maxDigit = 0;
+    for (int max = *std::max_element(vec.begin(), vec.end());
+         max >= numBuckets; max /= numBuckets) {
+        maxDigit++;
+    }
+    return maxDigit;
+}
+
+// Copies the items into buckets by their digit-th least significant
+// digit.  Buckets are allocated with their exact size, counted in a
+// first pass, so that they don't move while registered as auxiliary
+// buffers.
+template <typename It>
+static std::vector<RadixBucket> distribute(It begin, It end, int digit,
+                                           const int numBuckets) {
+    std::vector<std::size_t> sizes(numBuckets);
+    for (auto it = begin; it != end; it++) {
+        sizes[LSDigit(*it, digit, numBuckets)]++;
+    }
+
+    std::vector<RadixBucket> buckets(numBuckets);
+    for (int b = 0; b < numBuckets; b++) {
+        buckets[b].items.resize(sizes[b]);
+        buckets[b].auxBuffer.emplace(buckets[b].items);
+    }
+
+    std::vector<std::size_t> positions(numBuckets);
+    for (auto it = begin; it != end; it++) {
+        const int bucket = LSDigit(*it, digit, numBuckets);
+        buckets[bucket].items[positions[bucket]++] = std::move(*it);
+    }
+
+    return buckets;
+}
+
+// Simply moves bucket contents, in order, to the provided output
 // iterator, but does so in a visually appealing way.  Buckets are
 // written out "in parallel": first, index 0 will be written from each
 // bucket to it's correct place, then index 1, etc.
 template <typename It>
-static void concatenateBuckets(const std::vector<std::vector<int>> &buckets,
-                               It out) {
+static void concatenateBuckets(std::vector<RadixBucket> &buckets, It out) {
     std::vector<int> indices(buckets.size());
-    unsigned int maxBucketSize = buckets[0].size();
+    unsigned int maxBucketSize = buckets[0].items.size();
     indices[0] = 0;
     for (unsigned int b = 1; b < buckets.size(); ++b) {
-        unsigned int bsize = buckets[b].size();
+        unsigned int bsize = buckets[b].items.size();
         if (bsize > maxBucketSize) {
             maxBucketSize = bsize;
         }
-        indices[b] = indices[b - 1] + buckets[b - 1].size();
+        indices[b] = indices[b - 1] + buckets[b - 1].items.size();
     }
 
     unsigned int index = 0;
     while (index < maxBucketSize) {
         for (unsigned int j = 0; j < buckets.size(); ++j) {
-            auto &bucket = buckets[j];
+            auto &bucket = buckets[j].items;
             if (bucket.size() <= index) {
                 continue;
             }
 
-            *(out + indices[j] + index) = bucket[index];
+            *(out + indices[j] + index) = std::move(bucket[index]);
         }
         ++index;
     }
 }
 
 template <typename It>
-static void RadixSortMSDImpl(std::vector<int>::iterator beginBucket,
-                             std::vector<int>::iterator endBucket, It out,
-                             int digit, const int maxDigit,
+static void RadixSortMSDImpl(It begin, It end, int digit, const int maxDigit,
                              const int numBuckets) {
-    if ((endBucket - beginBucket) <= 1 || digit > maxDigit) {
+    if ((end - begin) <= 1 || digit > maxDigit) {
         return;
     }
 
-    using Bucket = std::vector<int>;
-    std::vector<Bucket> buckets(numBuckets);
-
-    for (auto it = beginBucket; it != endBucket; it++) {
-        const int val = *it;
-        const int bucket = LSDigit(val, maxDigit - digit, numBuckets);
-        buckets[bucket].push_back(val);
+    std::vector<std::size_t> sizes;
+    {
+        auto buckets = distribute(begin, end, maxDigit - digit, numBuckets);
+        concatenateBuckets(buckets, begin);
+        for (const auto &bucket : buckets) {
+            sizes.push_back(bucket.items.size());
+        }
     }
-
-    concatenateBuckets(buckets, out);
     digit++;
 
-    for (auto &bucket : buckets) {
-        RadixSortMSDImpl(bucket.begin(), bucket.end(), out, digit, maxDigit,
-                         numBuckets);
-        out += bucket.size();
+    for (auto size : sizes) {
+        RadixSortMSDImpl(begin, begin + size, digit, maxDigit, numBuckets);
+        begin += size;
     }
 }
 
-template <typename It>
-static void RadixSortLSDImpl(std::vector<int>::iterator beginBucket,
-                             std::vector<int>::iterator endBucket, It out,
-                             int digit, const int maxDigit,
-                             const int numBuckets) {
-    const auto size = endBucket - beginBucket;
-    if (size <= 1 || digit > maxDigit) {
-        return;
-    }
-
-    using Bucket = std::vector<int>;
-    std::vector<Bucket> buckets(numBuckets);
-
-    for (auto it = beginBucket; it != endBucket; it++) {
-        const int val = *it;
-        const int bucket = LSDigit(val, digit, numBuckets);
-        buckets[bucket].push_back(val);
-    }
+// Quadratic algorithms stop being usable somewhere around this size.
+static constexpr std::size_t QuadraticMaxSize = 4096;
 
-    concatenateBuckets(buckets, out);
-    std::copy(out, out + size, beginBucket);
-    digit++;
+static constexpr std::size_t DefaultWikiSortBudget = 64 * 1024;
 
-    RadixSortLSDImpl(beginBucket, endBucket, out, digit, maxDigit, numBuckets);
+// Sets the kernels of the algorithm for plain keys to sort, which
+// takes a span of any key type.
+template <typename Sort>
+static Algorithm withKernels(Algorithm algorithm, Sort sort) {
+    algorithm.sortInt32 = sort;
+    algorithm.sortInt64 = sort;
+    algorithm.sortFloat = sort;
+    return algorithm;
 }
 
-const QVector<Algorithm> &GetAlgorithms() {
-    static const QVector<Algorithm> algorithms = {
-        {.name = "QuickSort", .function = QuickSort},
-        {.name = "MergeSort", .function = MergeSort},
+static QVector<Algorithm> &algorithmRegistry() {
+    static QVector<Algorithm> algorithms = {
+        withKernels(
+            {.name = "QuickSort",
+             .function = QuickSort,
+             .inPlace = true,
+             .auxMemory = AuxMemory::Logarithmic},
+            [](auto keys) { quickSortImpl(keys.begin(), keys.end()); }),
+        withKernels(
+            {.name = "VectorQuickSort",
+             .function = VectorQuickSort,
+             .inPlace = true,
+             .auxMemory = AuxMemory::Logarithmic},
+            [](auto keys) { vectorSort(keys); }),
+        {.name = "MergeSort",
+         .function = MergeSort,
+         .stable = true,
+         .auxMemory = AuxMemory::Linear},
         {.name = "MergeSort (std::inplace_merge)",
-         .function = MergeSortStdInplaceMerge},
-        {.name = "MergeSort (std::merge)", .function = MergeSortStdMerge},
-        {.name = "Bottom-Up MergeSort", .function = BottomUpMergeSort},
-        {.name = "WikiSort", .function = Wiki::Sort},
-        {.name = "std::sort", .function = StdSort},
-        {.name = "std::stable_sort", .function = StdStableSort},
-        {.name = "std::sort_heap", .function = StdSortHeap},
+         .function = MergeSortStdInplaceMerge,
+         .stable = true,
+         .auxMemory = AuxMemory::Linear},
+        {.name = "MergeSort (std::merge)",
+         .function = MergeSortStdMerge,
+         .stable = true,
+         .auxMemory = AuxMemory::Linear},
+        {.name = "Bottom-Up MergeSort",
+         .function = BottomUpMergeSort,
+         .stable = true,
+         .auxMemory = AuxMemory::Linear},
+        {.name = "WikiSort (no cache)",
+         .function = WikiSort<Wiki::CacheKind::None>,
+         .stable = true,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Constant},
+        {.name = "WikiSort (512 item cache)",
+         .function = WikiSort<Wiki::CacheKind::Fixed>,
+         .stable = true,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Constant},
+        {.name = "WikiSort (sqrt cache)",
+         .function = WikiSort<Wiki::CacheKind::SquareRoot>,
+         .stable = true,
+         .auxMemory = AuxMemory::SquareRoot},
+        {.name = "WikiSort (half cache)",
+         .function = WikiSort<Wiki::CacheKind::Half>,
+         .stable = true,
+         .auxMemory = AuxMemory::Linear},
+        WikiSortWithBudget(DefaultWikiSortBudget),
+        withKernels(
+            {.name = "std::sort",
+             .function = StdSort,
+             .inPlace = true,
+             .auxMemory = AuxMemory::Logarithmic},
+            [](auto keys) { std::sort(keys.begin(), keys.end()); }),
+        withKernels(
+            {.name = "std::stable_sort",
+             .function = StdStableSort,
+             .stable = true,
+             .auxMemory = AuxMemory::Linear},
+            [](auto keys) { std::stable_sort(keys.begin(), keys.end()); }),
+        {.name = "std::sort_heap",
+         .function = StdSortHeap,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Constant},
 #ifdef HAVE_BOOST
-        {.name = "boost::sort::pdqsort", .function = BoostPdqSort},
-        {.name = "boost::sort::sample_sort", .function = BoostSampleSort},
-        {.name = "boost::sort::spinsort", .function = BoostSpinSort},
-        {.name = "boost::sort::flat_stable_sort",
-         .function = BoostFlatStableSort},
+        withKernels(
+            {.name = "boost::sort::pdqsort",
+             .function = BoostPdqSort,
+             .inPlace = true,
+             .auxMemory = AuxMemory::Logarithmic},
+            [](auto keys) { boost::sort::pdqsort(keys.begin(), keys.end()); }),
+        withKernels(
+            {.name = "boost::sort::sample_sort",
+             .function = BoostSampleSort,
+             .stable = true,
+             .auxMemory = AuxMemory::Linear,
+             .parallel = true},
+            [](auto keys) {
+                boost::sort::sample_sort(keys.begin(), keys.end());
+            }),
+        withKernels(
+            {.name = "boost::sort::spinsort",
+             .function = BoostSpinSort,
+             .stable = true,
+             .auxMemory = AuxMemory::Linear},
+            [](auto keys) { boost::sort::spinsort(keys.begin(), keys.end()); }),
+        withKernels(
+            {.name = "boost::sort::flat_stable_sort",
+             .function = BoostFlatStableSort,
+             .stable = true,
+             .auxMemory = AuxMemory::Linear},
+            [](auto keys) {
+                if (!keys.empty()) {
+                    boost::sort::flat_stable_sort(keys.begin(), keys.end());
+                }
+            }),
 #endif
-        {.name = "ShellSort", .function = ShellSort},
-        {.name = "InsertionSort", .function = InsertionSort},
-        {.name = "SelectionSort", .function = SelectionSort},
-        {.name = "BubbleSort", .function = BubbleSort},
-        {.name = "CocktailSort", .function = CocktailSort},
-        {.name = "RadixSort (MSD)", .function = RadixSortMSD},
-        {.name = "RadixSort (LSD)", .function = RadixSortLSD},
+        {.name = "ShellSort",
+         .function = ShellSort,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Constant,
+         .maxRecommendedSize = 100000},
+        {.name = "InsertionSort",
+         .function = InsertionSort,
+         .stable = true,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Constant,
+         .maxRecommendedSize = QuadraticMaxSize},
+        {.name = "SelectionSort",
+         .function = SelectionSort,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Constant,
+         .maxRecommendedSize = QuadraticMaxSize},
+        {.name = "BubbleSort",
+         .function = BubbleSort,
+         .stable = true,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Constant,
+         .maxRecommendedSize = QuadraticMaxSize},
+        {.name = "CocktailSort",
+         .function = CocktailSort,
+         .stable = true,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Constant,
+         .maxRecommendedSize = QuadraticMaxSize},
+        // Radix sorts rebuild the values from their keys, so they
+        // don't preserve the identity of equal items.
+        {.name = "RadixSort (MSD)",
+         .function = RadixSortMSD,
+         .auxMemory = AuxMemory::Linear},
+        {.name = "RadixSort (LSD)",
+         .function = RadixSortLSD,
+         .auxMemory = AuxMemory::Linear},
+        // Picks one of the sorts above by the presortedness of a
+        // sample of the items, see Auto.h.
+        {.name = "Auto",
+         .function = AutoSort,
+         .auxMemory = AuxMemory::Linear},
+        {.name = "QuickSelect",
+         .select = Select::QuickSelect,
+         .selection = SelectionKind::Nth,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Constant},
+        {.name = "IntroSelect",
+         .select = Select::IntroSelect,
+         .selection = SelectionKind::Nth,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Logarithmic},
+        {.name = "Floyd-Rivest",
+         .select = Select::FloydRivest,
+         .selection = SelectionKind::Nth,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Logarithmic},
+        {.name = "Median of medians",
+         .select = Select::MedianOfMedians,
+         .selection = SelectionKind::Nth,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Logarithmic},
+        {.name = "std::nth_element",
+         .select = Select::StdNthElement,
+         .selection = SelectionKind::Nth,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Logarithmic},
+        {.name = "std::partial_sort",
+         .select = Select::StdPartialSort,
+         .selection = SelectionKind::TopK,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Constant},
+        {.name = "Heap top-k",
+         .select = Select::HeapTopK,
+         .selection = SelectionKind::TopK,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Constant},
+        {.name = "Partition top-k",
+         .select = Select::PartitionTopK,
+         .selection = SelectionKind::TopK,
+         .inPlace = true,
+         .auxMemory = AuxMemory::Logarithmic},
     };
 
     return algorithms;
 }
 
-// Test stuff
+const QVector<Algorithm> &GetAlgorithms() { return algorithmRegistry(); }
 
-static std::vector<SortItem> generateVector(int size) {
-    std::vector<SortItem> items;
-    for (int i = 0; i < size; i++) {
-        items.emplace_back(i);
+void RegisterAlgorithm(Algorithm algorithm) {
+    algorithmRegistry().append(std::move(algorithm));
+}
+
+QString auxMemoryName(AuxMemory aux) {
+    switch (aux) {
+    case AuxMemory::Constant:
+        return "O(1)";
+    case AuxMemory::Logarithmic:
+        return "O(log n)";
+    case AuxMemory::SquareRoot:
+        return "O(sqrt n)";
+    case AuxMemory::Linear:
+        return "O(n)";
     }
-    if (size > 1) {
-        do {
-            std::shuffle(items.begin(), items.end(), std::random_device());
-        } while (std::is_sorted(items.begin(), items.end()));
+    return {};
+}
+
+QString selectionKindName(SelectionKind kind) {
+    switch (kind) {
+    case SelectionKind::None:
+        return "all sorted";
+    case SelectionKind::Nth:
+        return "k-th smallest";
+    case SelectionKind::TopK:
+        return "k smallest, sorted";
     }
-    return items;
+    return {};
 }
 
-static bool check(const Algorithm &algorithm, int size) {
+std::size_t SelectionK::forSize(std::size_t numItems) const {
+    const double k = percent ? value * numItems / 100 : value;
+    return std::clamp<std::size_t>(std::llround(k), 1,
+                                   std::max<std::size_t>(numItems, 1));
+}
 
-    fprintf(stderr, "Checking algorithm '%s' with %d items...",
-            algorithm.name.toStdString().c_str(), size);
+std::optional<SelectionK> SelectionK::fromString(const QString &text) {
+    SelectionK k;
+    k.percent = text.endsWith('%');
+    bool ok;
+    k.value = (k.percent ? text.left(text.size() - 1) : text).toDouble(&ok);
+    if (!ok || k.value < 0 || (k.percent && k.value > 100)) {
+        return std::nullopt;
+    }
+    return k;
+}
 
-    std::vector<SortItem> items = generateVector(size);
-    const std::set<SortItem> beforeSet(items.begin(), items.end());
+QString keyTypeName(KeyType type) {
+    switch (type) {
+    case KeyType::Item:
+        return "item";
+    case KeyType::Int32:
+        return "int32";
+    case KeyType::Int64:
+        return "int64";
+    case KeyType::Float:
+        return "float";
+    }
+    return {};
+}
 
-    if (items.size() > 1) {
-        assert(!std::is_sorted(items.begin(), items.end()));
+std::optional<KeyType> keyTypeFromName(const QString &name) {
+    for (auto type :
+         {KeyType::Item, KeyType::Int32, KeyType::Int64, KeyType::Float}) {
+        if (keyTypeName(type) == name) {
+            return type;
+        }
     }
+    return std::nullopt;
+}
 
-    algorithm.function(items);
+KeyTypes Algorithm::keyTypes() const {
+    KeyTypes types;
+    types.setFlag(KeyType::Item, function || select);
+    types.setFlag(KeyType::Int32, bool(sortInt32));
+    types.setFlag(KeyType::Int64, bool(sortInt64));
+    types.setFlag(KeyType::Float, bool(sortFloat));
+    return types;
+}
 
-    assert(std::is_sorted(items.begin(), items.end()));
+bool Algorithm::supports(KeyType type) const {
+    return keyTypes().testFlag(type);
+}
 
-    const std::set<SortItem> afterSet(items.begin(), items.end());
+bool Algorithm::recommendedFor(std::size_t size) const {
+    return size >= minRecommendedSize && size <= maxRecommendedSize;
+}
 
-    assert(beforeSet == afterSet);
+void Algorithm::run(std::vector<SortItem> &items, std::size_t k) const {
+    if (!select) {
+        function(items);
+    } else if (!items.empty()) {
+        select(items, std::clamp<std::size_t>(k, 1, items.size()));
+    }
+}
 
-    fprintf(stderr, "ok\n");
+bool Algorithm::isDone(const std::vector<SortItem> &items,
+                       std::size_t k) const {
+    if (selection == SelectionKind::None || items.empty()) {
+        return std::is_sorted(items.begin(), items.end());
+    }
 
-    return true;
+    const auto nth =
+        items.begin() + std::clamp<std::size_t>(k, 1, items.size()) - 1;
+    if (selection == SelectionKind::TopK &&
+        !std::is_sorted(items.begin(), nth)) {
+        return false;
+    }
+    return std::all_of(items.begin(), nth,
+                       [&](const SortItem &item) { return item <= *nth; }) &&
+           std::all_of(nth, items.end(),
+                       [&](const SortItem &item) { return item >= *nth; });
 }
 
-void TestAlgorithms() {
-    for (const auto &algo : GetAlgorithms()) {
-        // check(algo, 0);
-        check(algo, 1);
-        check(algo, 2);
-        check(algo, 10);
-        check(algo, 17);
-        check(algo, 25);
-        check(algo, 100);
-        check(algo, 1000);
+bool AlgorithmFilter::matches(const Algorithm &algorithm) const {
+    if (stableOnly && !algorithm.stable) {
+        return false;
+    }
+    if (inPlaceOnly && !algorithm.inPlace) {
+        return false;
+    }
+    if (excludeParallel && algorithm.parallel) {
+        return false;
     }
+    if (keyType && !algorithm.supports(*keyType)) {
+        return false;
+    }
+    if (size && !algorithm.recommendedFor(*size)) {
+        return false;
+    }
+    return true;
 }
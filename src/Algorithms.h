@@ -3,15 +3,118 @@
 #define ALGORITHMS_H
 
 #include "SortItem.h"
+#include <QFlags>
 #include <QString>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <optional>
+#include <span>
+
+// How much extra memory an algorithm needs, as a function of the
+// number of items.
+enum class AuxMemory {
+    Constant,
+    Logarithmic,
+    SquareRoot,
+    Linear,
+};
+
+QString auxMemoryName(AuxMemory);
+
+// What an algorithm leaves behind.  Selection algorithms only order
+// the items as far as needed to find the k smallest of them.
+enum class SelectionKind {
+    // All items sorted.
+    None,
+    // The k-th smallest item at index k - 1, with no larger items
+    // before it and no smaller items after it.
+    Nth,
+    // The k smallest items sorted at the front.
+    TopK,
+};
+
+QString selectionKindName(SelectionKind);
+
+// k of selection algorithms: a number of items, or a percentage of
+// them, e.g. "10%".
+struct SelectionK {
+    double value = 50;
+    bool percent = true;
+
+    std::size_t forSize(std::size_t numItems) const;
+
+    static std::optional<SelectionK> fromString(const QString &);
+};
+
+enum class KeyType {
+    Item = 0x1,
+    Int32 = 0x2,
+    Int64 = 0x4,
+    Float = 0x8,
+};
+Q_DECLARE_FLAGS(KeyTypes, KeyType)
+Q_DECLARE_OPERATORS_FOR_FLAGS(KeyTypes)
+
+QString keyTypeName(KeyType);
+std::optional<KeyType> keyTypeFromName(const QString &);
 
 struct Algorithm {
     QString name;
-    std::function<void(std::vector<SortItem> &)> function;
+    // Unset for selection algorithms, which set select instead.
+    std::function<void(std::vector<SortItem> &)> function = {};
+
+    // Optional kernels operating on plain keys, without any
+    // instrumentation.  These are only used by the benchmark harness
+    // and for sorting files.
+    std::function<void(std::span<std::int32_t>)> sortInt32 = {};
+    std::function<void(std::span<std::int64_t>)> sortInt64 = {};
+    std::function<void(std::span<float>)> sortFloat = {};
+
+    // Selects the k smallest items, see SelectionKind.
+    std::function<void(std::vector<SortItem> &, std::size_t k)> select = {};
+    SelectionKind selection = SelectionKind::None;
+
+    bool stable = false;
+    bool inPlace = false;
+    AuxMemory auxMemory = AuxMemory::Linear;
+    bool parallel = false;
+
+    // Range of sizes for which the algorithm is a sensible choice.
+    std::size_t minRecommendedSize = 0;
+    std::size_t maxRecommendedSize = std::numeric_limits<std::size_t>::max();
+
+    KeyTypes keyTypes() const;
+    bool supports(KeyType) const;
+    bool recommendedFor(std::size_t size) const;
+
+    // Sorts the items, or selects the k smallest of them, with k
+    // clamped to the number of items.
+    void run(std::vector<SortItem> &, std::size_t k) const;
+    // Whether the items are ordered as run() promises.
+    bool isDone(const std::vector<SortItem> &, std::size_t k) const;
+};
+
+// Selects algorithms by their capabilities.  Unset fields match
+// everything.
+struct AlgorithmFilter {
+    bool stableOnly = false;
+    bool inPlaceOnly = false;
+    bool excludeParallel = false;
+    std::optional<KeyType> keyType;
+    std::optional<std::size_t> size;
+
+    bool matches(const Algorithm &) const;
 };
 
 const QVector<Algorithm> &GetAlgorithms();
-void TestAlgorithms();
+
+// Adds an algorithm to the list returned by GetAlgorithms().  Must
+// be called before anything takes references to the list, i.e. at
+// startup.
+void RegisterAlgorithm(Algorithm);
+
+// WikiSort limited to a cache of at most this many bytes.
+Algorithm WikiSortWithBudget(std::size_t bytes);
 
 #endif
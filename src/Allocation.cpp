@@ -0,0 +1,197 @@
+#include "Allocation.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+static thread_local AllocationTracker *currentTracker = nullptr;
+
+AllocationStats AllocationTracker::stats() const {
+    return {
+        .allocations = m_allocations.load(std::memory_order_relaxed),
+        .bytesAllocated = m_bytesAllocated.load(std::memory_order_relaxed),
+        .peakBytes = m_peakBytes.load(std::memory_order_relaxed),
+    };
+}
+
+void AllocationTracker::reset() {
+    m_allocations = 0;
+    m_bytesAllocated = 0;
+    m_liveBytes = 0;
+    m_peakBytes = 0;
+}
+
+void AllocationTracker::onAllocate(std::size_t size) {
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    m_allocations.store(m_allocations.load(relaxed) + 1, relaxed);
+    m_bytesAllocated.store(m_bytesAllocated.load(relaxed) + size, relaxed);
+
+    const auto live = m_liveBytes.load(relaxed) + std::int64_t(size);
+    m_liveBytes.store(live, relaxed);
+    if (live > 0 && std::uint64_t(live) > m_peakBytes.load(relaxed)) {
+        m_peakBytes.store(live, relaxed);
+    }
+}
+
+void AllocationTracker::onFree(std::size_t size) {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    m_liveBytes.store(m_liveBytes.load(relaxed) - std::int64_t(size), relaxed);
+}
+
+AllocationTracker::Scope::Scope(AllocationTracker &tracker)
+    : m_previous(currentTracker) {
+    currentTracker = &tracker;
+}
+
+AllocationTracker::Scope::~Scope() { currentTracker = m_previous; }
+
+AllocationTracker::Suspend::Suspend() : m_previous(currentTracker) {
+    currentTracker = nullptr;
+}
+
+AllocationTracker::Suspend::~Suspend() { currentTracker = m_previous; }
+
+QString formatBytes(std::uint64_t bytes) {
+    const char *units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = bytes;
+    unsigned unit = 0;
+    while (value >= 1024 && unit + 1 < std::size(units)) {
+        value /= 1024;
+        unit++;
+    }
+    if (unit == 0) {
+        return QString("%1 B").arg(bytes);
+    }
+    return QString("%1 %2").arg(value, 0, 'f', 1).arg(units[unit]);
+}
+
+// Replacements for the global allocation functions.  Every block is
+// prefixed with its size, so that frees can be accounted for too, and
+// with where malloc() allocated it, which over-aligned blocks start
+// after.
+
+namespace {
+struct alignas(std::max_align_t) Header {
+    std::size_t size;
+    void *block;
+};
+} // namespace
+
+static void *allocate(std::size_t size,
+                      std::size_t alignment = alignof(Header)) noexcept {
+    // Room to move the header up to just before the alignment.
+    const std::size_t slack = alignment > alignof(Header) ? alignment : 0;
+    auto *block =
+        static_cast<char *>(std::malloc(sizeof(Header) + slack + size));
+    if (!block) {
+        return nullptr;
+    }
+    const auto first = reinterpret_cast<std::uintptr_t>(block + sizeof(Header));
+    auto *header = reinterpret_cast<Header *>(
+                       (first + alignment - 1) / alignment * alignment) -
+                   1;
+    header->size = size;
+    header->block = block;
+    if (currentTracker) {
+        currentTracker->onAllocate(size);
+    }
+    return header + 1;
+}
+
+static void deallocate(void *ptr) noexcept {
+    if (!ptr) {
+        return;
+    }
+    auto *header = static_cast<Header *>(ptr) - 1;
+    if (currentTracker) {
+        currentTracker->onFree(header->size);
+    }
+    std::free(header->block);
+}
+
+static void *allocateOrThrow(std::size_t size,
+                             std::size_t alignment = alignof(Header)) {
+    while (true) {
+        if (void *ptr = allocate(size, alignment)) {
+            return ptr;
+        }
+        auto handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void *operator new(std::size_t size) { return allocateOrThrow(size); }
+
+void *operator new[](std::size_t size) { return allocateOrThrow(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    return allocateOrThrow(size, std::size_t(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return allocateOrThrow(size, std::size_t(alignment));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+    return allocate(size, std::size_t(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+    return allocate(size, std::size_t(alignment));
+}
+
+void operator delete(void *ptr) noexcept { deallocate(ptr); }
+
+void operator delete[](void *ptr) noexcept { deallocate(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { deallocate(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept { deallocate(ptr); }
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+    deallocate(ptr);
+}
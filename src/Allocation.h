@@ -0,0 +1,58 @@
+/* -*- mode: c++; -*- */
+#ifndef ALLOCATION_H
+#define ALLOCATION_H
+
+#include <QString>
+#include <atomic>
+#include <cstdint>
+
+struct AllocationStats {
+    std::uint64_t allocations = 0;
+    std::uint64_t bytesAllocated = 0;
+    // Highest amount of memory allocated and not yet freed by the
+    // tracked thread, relative to when tracking started.
+    std::uint64_t peakBytes = 0;
+};
+
+// Counts heap allocations (through operator new) made by the threads
+// it is installed on.  Stats may be read from any thread.
+class AllocationTracker {
+  public:
+    AllocationStats stats() const;
+    void reset();
+
+    // Tracks allocations of the current thread while in scope.
+    class Scope {
+      public:
+        Scope(AllocationTracker &);
+        ~Scope();
+
+      private:
+        AllocationTracker *m_previous;
+    };
+
+    // Stops tracking allocations of the current thread while in
+    // scope, e.g. for bookkeeping done by instrumentation.
+    class Suspend {
+      public:
+        Suspend();
+        ~Suspend();
+
+      private:
+        AllocationTracker *m_previous;
+    };
+
+    void onAllocate(std::size_t);
+    void onFree(std::size_t);
+
+  private:
+    // Only ever written by the tracked thread.
+    std::atomic<std::uint64_t> m_allocations = 0;
+    std::atomic<std::uint64_t> m_bytesAllocated = 0;
+    std::atomic<std::int64_t> m_liveBytes = 0;
+    std::atomic<std::uint64_t> m_peakBytes = 0;
+};
+
+QString formatBytes(std::uint64_t bytes);
+
+#endif
@@ -0,0 +1,216 @@
+#include "Auto.h"
+#include "Algorithms.h"
+
+#include <QFile>
+#include <QStringList>
+#include <limits>
+
+// Items Auto samples, in blocks of consecutive items.
+static constexpr std::size_t SampleBlockSize = 32;
+static constexpr std::size_t SampleBlocks = 128;
+
+static constexpr auto Unbounded = std::numeric_limits<std::size_t>::max();
+
+// Calibration sizes aren't powers of two, which some algorithms, e.g.
+// WikiSort, are much faster on.
+static constexpr AutoSizeClass SizeClasses[] = {
+    {.maxSize = 64, .calibrationSize = 40},
+    {.maxSize = 4096, .calibrationSize = 1000},
+    {.maxSize = 262144, .calibrationSize = 100000},
+    {.maxSize = Unbounded, .calibrationSize = 1000000},
+};
+
+// Used if the table has no algorithm for some input, or one that isn't
+// registered, e.g. a Boost sort in a build without Boost.
+static const QString FallbackAlgorithm = "std::sort";
+
+QString inputClassName(InputClass input) {
+    switch (input) {
+    case InputClass::Sorted:
+        return "Sorted";
+    case InputClass::Reversed:
+        return "Reversed";
+    case InputClass::NearlySorted:
+        return "NearlySorted";
+    case InputClass::FewUnique:
+        return "FewUnique";
+    case InputClass::Random:
+        return "Random";
+    }
+    return {};
+}
+
+std::optional<InputClass> inputClassFromName(const QString &name) {
+    for (int i = 0; i < InputClassCount; i++) {
+        if (inputClassName(static_cast<InputClass>(i)) == name) {
+            return static_cast<InputClass>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+InputClass classifyInput(const Presortedness &p) {
+    if (p.runs <= 1) {
+        return InputClass::Sorted;
+    }
+    if (p.inversionRatio() > 0.9) {
+        return InputClass::Reversed;
+    }
+    if (p.runsRatio() < 0.05 || p.inversionRatio() < 0.05) {
+        return InputClass::NearlySorted;
+    }
+    if (p.duplicateRatio > 0.5) {
+        return InputClass::FewUnique;
+    }
+    return InputClass::Random;
+}
+
+ArrayOrder inputClassOrder(InputClass input) {
+    switch (input) {
+    case InputClass::Sorted:
+        return ArrayOrder::Ascending;
+    case InputClass::Reversed:
+        return ArrayOrder::Descending;
+    case InputClass::NearlySorted:
+        return ArrayOrder::MostlySorted;
+    case InputClass::FewUnique:
+        return ArrayOrder::FewUnique;
+    case InputClass::Random:
+        return ArrayOrder::Random;
+    }
+    return ArrayOrder::Random;
+}
+
+std::span<const AutoSizeClass> autoSizeClasses() { return SizeClasses; }
+
+// Calibrated with --calibrate --seed 1, in a build with Boost.
+static QVector<AutoRule> &table() {
+    static QVector<AutoRule> rules = {
+        {InputClass::Sorted, 64, "BubbleSort"},
+        {InputClass::Sorted, 4096, "boost::sort::spinsort"},
+        {InputClass::Sorted, 262144, "boost::sort::spinsort"},
+        {InputClass::Sorted, Unbounded, "boost::sort::flat_stable_sort"},
+        {InputClass::Reversed, 64, "boost::sort::pdqsort"},
+        {InputClass::Reversed, 4096, "boost::sort::spinsort"},
+        {InputClass::Reversed, 262144, "boost::sort::spinsort"},
+        {InputClass::Reversed, Unbounded, "boost::sort::flat_stable_sort"},
+        {InputClass::NearlySorted, 64, "InsertionSort"},
+        {InputClass::NearlySorted, 4096, "InsertionSort"},
+        {InputClass::NearlySorted, 262144, "boost::sort::flat_stable_sort"},
+        {InputClass::NearlySorted, Unbounded, "boost::sort::flat_stable_sort"},
+        {InputClass::FewUnique, 64, "QuickSort"},
+        {InputClass::FewUnique, 4096, "boost::sort::pdqsort"},
+        {InputClass::FewUnique, 262144, "boost::sort::pdqsort"},
+        {InputClass::FewUnique, Unbounded, "boost::sort::pdqsort"},
+        {InputClass::Random, 64, "boost::sort::pdqsort"},
+        {InputClass::Random, 4096, "boost::sort::pdqsort"},
+        {InputClass::Random, 262144, "RadixSort (LSD)"},
+        {InputClass::Random, Unbounded, "RadixSort (MSD)"},
+    };
+    return rules;
+}
+
+const QVector<AutoRule> &autoTable() { return table(); }
+
+void setAutoTable(QVector<AutoRule> rules) { table() = std::move(rules); }
+
+static const Algorithm *findCandidate(const QString &name) {
+    for (const auto &algorithm : GetAlgorithms()) {
+        if (algorithm.name == name && isAutoCandidate(algorithm)) {
+            return &algorithm;
+        }
+    }
+    return nullptr;
+}
+
+bool loadAutoTable(const QString &path, QString *error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *error = QString("Can't open %1: %2").arg(path, file.errorString());
+        return false;
+    }
+
+    QVector<AutoRule> rules;
+    const auto lines = QString::fromUtf8(file.readAll()).split('\n');
+    for (int number = 1; number <= lines.size(); number++) {
+        const auto &line = lines[number - 1];
+        if (line.trimmed().isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        const auto fields = line.split('\t');
+        bool ok = fields.size() == 3;
+        const auto input = ok ? inputClassFromName(fields[0]) : std::nullopt;
+        auto maxSize = Unbounded;
+        if (ok && fields[1] != "-") {
+            maxSize = fields[1].toULongLong(&ok);
+        }
+        if (!ok || !input) {
+            *error = QString("%1:%2: Expected a class, a size and an "
+                             "algorithm separated by tabs")
+                         .arg(path)
+                         .arg(number);
+            return false;
+        }
+        if (!findCandidate(fields[2])) {
+            *error = QString("%1:%2: Unknown or unsuitable algorithm: %3")
+                         .arg(path)
+                         .arg(number)
+                         .arg(fields[2]);
+            return false;
+        }
+        rules.append({*input, maxSize, fields[2]});
+    }
+
+    setAutoTable(std::move(rules));
+    return true;
+}
+
+QString formatAutoTable(const QVector<AutoRule> &rules) {
+    QString text = "# class\tup to size\talgorithm\n";
+    for (const auto &rule : rules) {
+        text += QString("%1\t%2\t%3\n")
+                    .arg(inputClassName(rule.input))
+                    .arg(rule.maxSize == Unbounded
+                             ? QString("-")
+                             : QString::number(rule.maxSize))
+                    .arg(rule.algorithm);
+    }
+    return text;
+}
+
+bool isAutoCandidate(const Algorithm &algorithm) {
+    return algorithm.function && algorithm.selection == SelectionKind::None &&
+           !algorithm.parallel && algorithm.name != "Auto";
+}
+
+const Algorithm &autoChoice(const Presortedness &presortedness) {
+    const auto input = classifyInput(presortedness);
+    for (const auto &rule : autoTable()) {
+        if (rule.input == input && presortedness.size <= rule.maxSize) {
+            if (const auto *algorithm = findCandidate(rule.algorithm)) {
+                return *algorithm;
+            }
+            break;
+        }
+    }
+    return *findCandidate(FallbackAlgorithm);
+}
+
+void AutoSort(std::vector<SortItem> &vec) {
+    const auto size = vec.size();
+    std::vector<int> sample;
+    if (size <= SampleBlockSize * SampleBlocks) {
+        sample.assign(vec.begin(), vec.end());
+    } else {
+        sample.reserve(SampleBlockSize * SampleBlocks);
+        const auto stride = size / SampleBlocks;
+        for (std::size_t block = 0; block < SampleBlocks; block++) {
+            const auto begin = vec.begin() + block * stride;
+            sample.insert(sample.end(), begin, begin + SampleBlockSize);
+        }
+    }
+
+    autoChoice(estimatePresortedness(sample, SampleBlockSize, size))
+        .function(vec);
+}
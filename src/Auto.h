@@ -0,0 +1,73 @@
+/* -*- mode: c++; -*- */
+#ifndef AUTO_H
+#define AUTO_H
+
+#include "Presortedness.h"
+#include "SortItem.h"
+
+#include <QString>
+#include <QVector>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <vector>
+
+struct Algorithm;
+
+// Kinds of inputs the Auto algorithm tells apart by their
+// presortedness.
+enum class InputClass {
+    Sorted,
+    Reversed,
+    // Few runs or few inversions.
+    NearlySorted,
+    FewUnique,
+    Random,
+};
+
+inline constexpr int InputClassCount = 5;
+
+QString inputClassName(InputClass);
+std::optional<InputClass> inputClassFromName(const QString &);
+InputClass classifyInput(const Presortedness &);
+
+// Order of generated items of the class, to calibrate with.
+ArrayOrder inputClassOrder(InputClass);
+
+// Sizes of the table, each up to maxSize items, calibrated with
+// calibrationSize items.  The last one is unbounded.
+struct AutoSizeClass {
+    std::size_t maxSize;
+    int calibrationSize;
+};
+
+std::span<const AutoSizeClass> autoSizeClasses();
+
+// Entry of the table of the algorithm Auto picks for items of a class,
+// of up to maxSize items.
+struct AutoRule {
+    InputClass input;
+    std::size_t maxSize;
+    QString algorithm;
+};
+
+const QVector<AutoRule> &autoTable();
+void setAutoTable(QVector<AutoRule>);
+
+// Reads and writes tables as tab-separated class, size and algorithm
+// lines.
+bool loadAutoTable(const QString &path, QString *error);
+QString formatAutoTable(const QVector<AutoRule> &);
+
+// Whether Auto may pick the algorithm: a sequential sort of items other
+// than Auto itself.
+bool isAutoCandidate(const Algorithm &);
+
+// Algorithm Auto picks for items like these.
+const Algorithm &autoChoice(const Presortedness &);
+
+// Estimates the presortedness of the items from a sample, and sorts
+// them with autoChoice().
+void AutoSort(std::vector<SortItem> &);
+
+#endif
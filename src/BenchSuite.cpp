@@ -0,0 +1,400 @@
+#include "BenchSuite.h"
+#include "Affinity.h"
+#include "Algorithms.h"
+#include "Measurement.h"
+#include "SortItem.h"
+#include "VectorSort.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+// The matrix and the seed are fixed, so that results stay comparable
+// with baselines.  --swaps doesn't apply, as SortedWithSwaps isn't part
+// of the matrix.
+static constexpr ArrayOrder SuiteOrders[] = {
+    ArrayOrder::Random,       ArrayOrder::Ascending, ArrayOrder::Descending,
+    ArrayOrder::MostlySorted, ArrayOrder::FewUnique,
+};
+static constexpr int SuiteSizes[] = {1000, 100000};
+static constexpr std::uint64_t SuiteSeed = 1;
+
+// 2 counts constructions as writes, and copies and moves.
+static constexpr int BaselineVersion = 2;
+
+// Exit status which ctest counts as a skipped test.
+static constexpr int SkippedStatus = 77;
+
+// Changes of median times below this are noise, whatever their ratio.
+static constexpr double MinTimeChangeMs = 0.1;
+
+struct SuiteOptions {
+    QString baselinePath;
+    QString savePath;
+    int repetitions = 0;
+    MeasurementOptions measurement;
+    double timeThreshold = 0;
+    double opsThreshold = 0;
+};
+
+void addBenchSuiteOptions(QCommandLineParser &parser) {
+    parser.addOptions({
+        {"bench-suite", "Run the performance regression suite and exit"},
+        {"baseline",
+         "Compare the results of --bench-suite with this baseline, and "
+         "fail if they regressed",
+         "file"},
+        {"save-baseline", "Save the results of --bench-suite to this file",
+         "file"},
+        {"repetitions",
+         "Runs of each benchmark of --bench-suite, of which the median "
+         "time counts",
+         "count", "5"},
+        {"time-threshold",
+         "Percentage by which median times may exceed the baseline",
+         "percent", "10"},
+        {"ops-threshold",
+         "Percentage by which operation counts may exceed the baseline",
+         "percent", "1"},
+    });
+}
+
+static std::optional<SuiteOptions>
+parseOptions(const QCommandLineParser &parser) {
+    SuiteOptions options;
+    options.baselinePath = parser.value("baseline");
+    options.savePath = parser.value("save-baseline");
+
+    bool ok;
+    options.repetitions = parser.value("repetitions").toInt(&ok);
+    if (!ok || options.repetitions <= 0) {
+        fprintf(stderr, "Invalid repetitions: %s\n",
+                qPrintable(parser.value("repetitions")));
+        return std::nullopt;
+    }
+
+    // A fixed number of runs, so that results compare with baselines.
+    const auto measurement = parseMeasurementOptions(parser);
+    if (!measurement) {
+        return std::nullopt;
+    }
+    options.measurement = *measurement;
+    options.measurement.minRuns = options.repetitions;
+    options.measurement.maxRuns = options.repetitions;
+
+    options.timeThreshold = parser.value("time-threshold").toDouble(&ok) / 100;
+    if (!ok || options.timeThreshold < 0) {
+        fprintf(stderr, "Invalid time threshold: %s\n",
+                qPrintable(parser.value("time-threshold")));
+        return std::nullopt;
+    }
+
+    options.opsThreshold = parser.value("ops-threshold").toDouble(&ok) / 100;
+    if (!ok || options.opsThreshold < 0) {
+        fprintf(stderr, "Invalid ops threshold: %s\n",
+                qPrintable(parser.value("ops-threshold")));
+        return std::nullopt;
+    }
+
+    return options;
+}
+
+struct SuiteResult {
+    QString algorithm;
+    QString order;
+    int size = 0;
+    double medianMs = 0;
+    // Operations of one instrumented run.
+    OperationCounts operations = {};
+
+    QString key() const {
+        return QString("%1/%2/%3").arg(algorithm, order).arg(size);
+    }
+};
+
+static const std::pair<const char *, std::uint64_t OperationCounts::*>
+    OpCounts[] = {
+        {"comparisons", &OperationCounts::comparisons},
+        {"reads", &OperationCounts::reads},
+        {"writes", &OperationCounts::writes},
+        {"swaps", &OperationCounts::swaps},
+        {"copies", &OperationCounts::copies},
+        {"moves", &OperationCounts::moves},
+};
+
+// Returns nothing if the algorithm didn't sort the items.
+static std::optional<SuiteResult> runCase(const Algorithm &algorithm,
+                                         ArrayOrder order, int size,
+                                         const MeasurementOptions &options) {
+    const auto items = generateVector(size, order, SuiteSeed, std::nullopt);
+    const auto k = SelectionK().forSize(size);
+    SuiteResult result{.algorithm = algorithm.name,
+                       .order = arrayOrderName(order),
+                       .size = size};
+
+    const auto measurement =
+        measure(options, [&](int) -> std::optional<qint64> {
+            auto vec = items;
+            if (options.flushCaches) {
+                flushCaches();
+            }
+            QElapsedTimer timer;
+            timer.start();
+            algorithm.run(vec, k);
+            const auto nsecs = timer.nsecsElapsed();
+            if (!algorithm.isDone(vec, k)) {
+                return std::nullopt;
+            }
+            return nsecs;
+        });
+    if (!measurement) {
+        return std::nullopt;
+    }
+    result.medianMs = measurement->median / 1e6;
+
+    auto vec = items;
+    OperationCounter counter(result.operations);
+    SortItem::setCallbacksForCurrentThread(&counter);
+    algorithm.run(vec, k);
+    SortItem::setCallbacksForCurrentThread(nullptr);
+
+    return result;
+}
+
+static QString compilerName() {
+#if defined(__clang__)
+    return QString("clang %1").arg(__clang_version__);
+#elif defined(__GNUC__)
+    return QString("gcc %1").arg(__VERSION__);
+#elif defined(_MSC_VER)
+    return QString("msvc %1").arg(_MSC_VER);
+#else
+    return "unknown";
+#endif
+}
+
+// What the results depend on besides the code.
+static QJsonObject environment() {
+    QJsonObject environment;
+    environment["compiler"] = compilerName();
+    environment["qt"] = qVersion();
+    environment["cpu"] = QSysInfo::currentCpuArchitecture();
+    environment["host"] = QSysInfo::machineHostName();
+    environment["topology"] = describeTopology();
+    environment["placement"] = threadPlacement().toString();
+    environment["vectorTarget"] = vectorTargetName(vectorTarget());
+#ifdef NDEBUG
+    environment["assertions"] = false;
+#else
+    environment["assertions"] = true;
+#endif
+    return environment;
+}
+
+static std::optional<QJsonObject> loadBaseline(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "Can't open %s: %s\n", qPrintable(path),
+                qPrintable(file.errorString()));
+        return std::nullopt;
+    }
+
+    QJsonParseError error;
+    const auto document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError) {
+        fprintf(stderr, "%s: %s\n", qPrintable(path),
+                qPrintable(error.errorString()));
+        return std::nullopt;
+    }
+
+    const auto baseline = document.object();
+    if (baseline["version"].toInt() != BaselineVersion) {
+        fprintf(stderr, "%s: Unsupported baseline version\n",
+                qPrintable(path));
+        return std::nullopt;
+    }
+    return baseline;
+}
+
+static bool saveBaseline(const QString &path,
+                         const std::vector<SuiteResult> &results,
+                         int repetitions) {
+    QJsonArray array;
+    for (const auto &result : results) {
+        QJsonObject object;
+        object["algorithm"] = result.algorithm;
+        object["order"] = result.order;
+        object["size"] = result.size;
+        object["medianMs"] = result.medianMs;
+        for (const auto &[name, count] : OpCounts) {
+            object[name] = double(result.operations.*count);
+        }
+        array.append(object);
+    }
+
+    QJsonObject baseline;
+    baseline["version"] = BaselineVersion;
+    baseline["environment"] = environment();
+    baseline["repetitions"] = repetitions;
+    baseline["results"] = array;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(QJsonDocument(baseline).toJson()) < 0 || !file.commit()) {
+        fprintf(stderr, "Can't write %s: %s\n", qPrintable(path),
+                qPrintable(file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+// Results of the baseline by their key().
+static std::map<QString, SuiteResult>
+baselineResults(const QJsonObject &baseline) {
+    std::map<QString, SuiteResult> results;
+    for (const auto &value : baseline["results"].toArray()) {
+        const auto object = value.toObject();
+        SuiteResult result{.algorithm = object["algorithm"].toString(),
+                           .order = object["order"].toString(),
+                           .size = object["size"].toInt(),
+                           .medianMs = object["medianMs"].toDouble()};
+        for (const auto &[name, count] : OpCounts) {
+            result.operations.*count = object[name].toDouble();
+        }
+        results[result.key()] = result;
+    }
+    return results;
+}
+
+// Describes how the result compares with the baseline's, and whether
+// it regressed.
+static QString compare(const SuiteResult &result, const SuiteResult &base,
+                       const SuiteOptions &options, bool &regressed) {
+    QStringList changes;
+    const double timeChange = result.medianMs - base.medianMs;
+    if (std::abs(timeChange) >= MinTimeChangeMs &&
+        std::abs(timeChange) > base.medianMs * options.timeThreshold) {
+        regressed |= timeChange > 0;
+        changes.append(timeChange > 0 ? "SLOWER" : "faster");
+    }
+
+    for (const auto &[name, count] : OpCounts) {
+        const auto before = base.operations.*count;
+        const auto after = result.operations.*count;
+        if (after > before * (1 + options.opsThreshold)) {
+            regressed = true;
+            changes.append(QString("MORE %1 (%2 -> %3)")
+                               .arg(name)
+                               .arg(before)
+                               .arg(after));
+        }
+    }
+
+    return changes.isEmpty() ? QString("ok") : changes.join(", ");
+}
+
+int RunBenchSuite(const QCommandLineParser &parser) {
+    const auto options = parseOptions(parser);
+    if (!options) {
+        return EXIT_FAILURE;
+    }
+
+    std::map<QString, SuiteResult> baseline;
+    if (!options->baselinePath.isEmpty()) {
+        // Nothing to compare with, e.g. on a new machine.
+        if (!QFile::exists(options->baselinePath)) {
+            fprintf(stderr,
+                    "No baseline at %s, skipping; save one with "
+                    "--save-baseline\n",
+                    qPrintable(options->baselinePath));
+            return SkippedStatus;
+        }
+
+        const auto object = loadBaseline(options->baselinePath);
+        if (!object) {
+            return EXIT_FAILURE;
+        }
+        baseline = baselineResults(*object);
+
+        // Results of different machines or builds differ, which is
+        // what comparing after e.g. a compiler upgrade is for.
+        const auto then = (*object)["environment"].toObject();
+        const auto now = environment();
+        for (const auto &key : now.keys()) {
+            if (then[key] != now[key]) {
+                printf("%s changed since the baseline\n", qPrintable(key));
+            }
+        }
+    }
+
+    printf("%-36s %-16s %10s %12s %12s  %s\n", "algorithm", "order", "size",
+           "ms", "baseline ms", "result");
+
+    std::vector<SuiteResult> results;
+    int regressions = 0;
+    for (const auto &algorithm : GetAlgorithms()) {
+        // Their times and counts vary from run to run.
+        if (algorithm.parallel) {
+            continue;
+        }
+
+        for (auto order : SuiteOrders) {
+            for (int size : SuiteSizes) {
+                if (!algorithm.recommendedFor(size)) {
+                    continue;
+                }
+
+                printf("%-36s %-16s %10d ",
+                       algorithm.name.toStdString().c_str(),
+                       arrayOrderName(order).toStdString().c_str(), size);
+                const auto result =
+                    runCase(algorithm, order, size, options->measurement);
+                if (!result) {
+                    printf("%12s\n", "NOT SORTED");
+                    regressions++;
+                    continue;
+                }
+                results.push_back(*result);
+
+                printf("%12.3f ", result->medianMs);
+                const auto base = baseline.find(result->key());
+                if (base == baseline.end()) {
+                    printf("%12s%s\n", "-",
+                           options->baselinePath.isEmpty() ? "" : "  new");
+                } else {
+                    bool regressed = false;
+                    const auto status =
+                        compare(*result, base->second, *options, regressed);
+                    printf("%12.3f  %s\n", base->second.medianMs,
+                           qPrintable(status));
+                    regressions += regressed;
+                    baseline.erase(base);
+                }
+                fflush(stdout);
+            }
+        }
+    }
+
+    if (!options->baselinePath.isEmpty()) {
+        for (const auto &[key, result] : baseline) {
+            printf("%s: in the baseline, but not run\n", qPrintable(key));
+        }
+        printf("%d of %zu benchmarks regressed\n", regressions,
+               results.size());
+    }
+
+    if (!options->savePath.isEmpty() &&
+        !saveBaseline(options->savePath, results, options->repetitions)) {
+        return EXIT_FAILURE;
+    }
+
+    return regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,14 @@
+/* -*- mode: c++; -*- */
+#ifndef BENCHSUITE_H
+#define BENCHSUITE_H
+
+class QCommandLineParser;
+
+// Performance regression suite, run with --bench-suite: benchmarks a
+// fixed matrix of algorithms, orders and sizes, and compares the
+// results with a JSON baseline.  Exits with 77, which ctest counts as
+// skipped, if the baseline doesn't exist.
+void addBenchSuiteOptions(QCommandLineParser &);
+int RunBenchSuite(const QCommandLineParser &);
+
+#endif
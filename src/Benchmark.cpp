@@ -0,0 +1,474 @@
+#include "Benchmark.h"
+#include "Affinity.h"
+#include "Algorithms.h"
+#include "Allocation.h"
+#include "Auto.h"
+#include "Comparison.h"
+#include "Measurement.h"
+#include "PerfCounters.h"
+#include "SortItem.h"
+#include "VectorSort.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+
+struct BenchmarkOptions {
+    QVector<int> sizes;
+    QVector<ArrayOrder> orders;
+    QString algorithmPattern;
+    AlgorithmFilter filter;
+    KeyType keyType = KeyType::Item;
+    std::optional<ComparisonModel> comparison;
+    bool allSizes = false;
+    bool perf = false;
+    std::uint64_t seed = 0;
+    std::optional<std::uint64_t> swaps;
+    // Generate the input of each run from the seed and the run.
+    bool varyInput = false;
+    SelectionK selectK;
+    MeasurementOptions measurement;
+};
+
+void addBenchmarkOptions(QCommandLineParser &parser) {
+    parser.addOptions({
+        {"benchmark", "Benchmark algorithms and exit"},
+        {"sizes", "Comma-separated list of sizes to benchmark", "sizes",
+         "1000,10000,100000"},
+        {"orders", "Comma-separated list of initial orders to benchmark",
+         "orders", "Random"},
+        {"algorithms", "Only benchmark algorithms whose name contains this",
+         "substring"},
+        {"stable", "Only benchmark stable algorithms"},
+        {"in-place", "Only benchmark in-place algorithms"},
+        {"no-parallel", "Don't benchmark parallel algorithms"},
+        {"key-type", "Sort keys of this type: item, int32, int64 or float",
+         "type", "item"},
+        {"all-sizes",
+         "Also benchmark algorithms outside of their recommended size range"},
+        {"perf", "Report hardware performance counters for each run"},
+        {"comparison",
+         "Cost of comparing items: int, spin:NS (busy-wait NS nanoseconds), "
+         "string (locale collation) or tuple",
+         "model", "int"},
+        {"normalized-keys",
+         "Compute a byte string key per item before sorting, and compare "
+         "the keys instead of the items"},
+        {"vary-input",
+         "Generate different input for each run, from --seed and the number "
+         "of the run, instead of sorting the same input each time"},
+        {"calibrate",
+         "Find the fastest algorithms for each kind of input and print "
+         "them as a table for --auto-table"},
+    });
+}
+
+static std::optional<BenchmarkOptions>
+parseOptions(const QCommandLineParser &parser) {
+    BenchmarkOptions options;
+
+    for (const auto &size : parser.value("sizes").split(',')) {
+        bool ok;
+        int value = size.toInt(&ok);
+        if (!ok || value < 0) {
+            fprintf(stderr, "Invalid size: %s\n", qPrintable(size));
+            return std::nullopt;
+        }
+        options.sizes.append(value);
+    }
+
+    for (const auto &name : parser.value("orders").split(',')) {
+        const auto order = arrayOrderFromName(name);
+        if (!order) {
+            fprintf(stderr, "Invalid order: %s\n", qPrintable(name));
+            return std::nullopt;
+        }
+        options.orders.append(*order);
+    }
+
+    auto keyType = keyTypeFromName(parser.value("key-type"));
+    if (!keyType) {
+        fprintf(stderr, "Invalid key type: %s\n",
+                qPrintable(parser.value("key-type")));
+        return std::nullopt;
+    }
+
+    options.keyType = *keyType;
+
+    auto comparison = ComparisonModel::fromString(parser.value("comparison"));
+    if (!comparison) {
+        fprintf(stderr, "Invalid comparison model: %s\n",
+                qPrintable(parser.value("comparison")));
+        return std::nullopt;
+    }
+    comparison->normalizedKeys = parser.isSet("normalized-keys");
+    if (comparison->kind != ComparisonKind::Int ||
+        comparison->normalizedKeys) {
+        if (*keyType != KeyType::Item) {
+            fprintf(stderr, "--comparison and --normalized-keys need "
+                            "--key-type item\n");
+            return std::nullopt;
+        }
+        options.comparison = comparison;
+    }
+    options.algorithmPattern = parser.value("algorithms");
+    options.filter.stableOnly = parser.isSet("stable");
+    options.filter.inPlaceOnly = parser.isSet("in-place");
+    options.filter.excludeParallel = parser.isSet("no-parallel");
+    options.filter.keyType = *keyType;
+    options.allSizes = parser.isSet("all-sizes");
+    options.perf = parser.isSet("perf");
+
+    options.seed = randomSeed();
+    if (parser.isSet("seed")) {
+        bool ok;
+        options.seed = parser.value("seed").toULongLong(&ok);
+        if (!ok) {
+            fprintf(stderr, "Invalid seed: %s\n",
+                    qPrintable(parser.value("seed")));
+            return std::nullopt;
+        }
+    }
+    options.swaps = swapsOption(parser);
+
+    const auto selectK = SelectionK::fromString(parser.value("select-k"));
+    if (!selectK) {
+        fprintf(stderr, "Invalid k: %s\n",
+                qPrintable(parser.value("select-k")));
+        return std::nullopt;
+    }
+    options.selectK = *selectK;
+
+    const auto measurement = parseMeasurementOptions(parser);
+    if (!measurement) {
+        return std::nullopt;
+    }
+    options.measurement = *measurement;
+    options.varyInput = parser.isSet("vary-input");
+
+    return options;
+}
+
+struct RunResult {
+    qint64 nsecs = 0;
+    bool sorted = false;
+    AllocationStats memory;
+    PerfCounts counters;
+    std::uint64_t comparisons = 0;
+};
+
+template <typename Key>
+static void sortKeys(const std::vector<SortItem> &items,
+                     const std::function<void(std::span<Key>)> &sort,
+                     PerfCounters *perf, bool flush, RunResult &result) {
+    std::vector<Key> keys(items.begin(), items.end());
+    if (flush) {
+        flushCaches();
+    }
+
+    AllocationTracker allocations;
+    QElapsedTimer timer;
+    {
+        AllocationTracker::Scope scope(allocations);
+        if (perf) {
+            perf->start();
+        }
+        timer.start();
+        sort(keys);
+        result.nsecs = timer.nsecsElapsed();
+        if (perf) {
+            result.counters = perf->stop();
+        }
+    }
+
+    result.memory = allocations.stats();
+    result.sorted = std::is_sorted(keys.begin(), keys.end());
+}
+
+// Runs the algorithm on the calling thread, which is also the thread
+// the performance counters (if any) were opened on.  Items compare as
+// the comparison model (if any) says.  Only sorting is timed, after
+// copying the items and flushing the caches if asked to.
+static RunResult runOnce(const Algorithm &algorithm, KeyType keyType,
+                         std::vector<SortItem> items, std::size_t k,
+                         PerfCounters *perf,
+                         const std::optional<ComparisonModel> &comparison,
+                         bool flush) {
+    RunResult result;
+
+    switch (keyType) {
+    case KeyType::Item: {
+        std::optional<ModelComparator> comparator;
+        if (comparison) {
+            const auto [min, max] = std::minmax_element(items.begin(),
+                                                        items.end());
+            comparator.emplace(*comparison, items.empty() ? 0 : min->value(),
+                               items.empty() ? -1 : max->value());
+            SortItem::setComparator(&*comparator);
+        }
+        if (flush) {
+            flushCaches();
+        }
+
+        AllocationTracker allocations;
+        QElapsedTimer timer;
+        {
+            AllocationTracker::Scope scope(allocations);
+            if (perf) {
+                perf->start();
+            }
+            timer.start();
+            if (comparator) {
+                comparator->normalize(items);
+            }
+            algorithm.run(items, k);
+            result.nsecs = timer.nsecsElapsed();
+            if (perf) {
+                result.counters = perf->stop();
+            }
+        }
+        result.memory = allocations.stats();
+
+        if (comparator) {
+            result.comparisons = comparator->comparisons();
+            SortItem::setComparator(nullptr);
+        }
+        result.sorted = algorithm.isDone(items, k);
+        break;
+    }
+    case KeyType::Int32:
+        sortKeys(items, algorithm.sortInt32, perf, flush, result);
+        break;
+    case KeyType::Int64:
+        sortKeys(items, algorithm.sortInt64, perf, flush, result);
+        break;
+    case KeyType::Float:
+        sortKeys(items, algorithm.sortFloat, perf, flush, result);
+        break;
+    }
+
+    return result;
+}
+
+static QString formatCount(std::optional<std::uint64_t> count) {
+    return count ? QString::number(*count) : QString("n/a");
+}
+
+int RunBenchmark(const QCommandLineParser &parser) {
+    auto options = parseOptions(parser);
+    if (!options) {
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+
+    std::optional<PerfCounters> perf;
+    if (options->perf) {
+        perf.emplace();
+        if (!perf->available()) {
+            fprintf(stderr, "Performance counters unavailable: %s\n",
+                    qPrintable(perf->errorString()));
+        }
+    }
+
+    // Passing them with --seed and --swaps reproduces the inputs.
+    printf("seed: %llu\n", (unsigned long long)options->seed);
+    if (options->swaps) {
+        printf("swaps: %llu\n", (unsigned long long)*options->swaps);
+    }
+    printf("topology: %s\n", qPrintable(describeTopology()));
+    printf("placement: %s\n", qPrintable(threadPlacement().toString()));
+    printf("vector target: %s\n",
+           qPrintable(vectorTargetName(vectorTarget())));
+    if (options->comparison) {
+        printf("comparison: %s%s\n",
+               qPrintable(options->comparison->toString()),
+               options->comparison->normalizedKeys ? ", normalized keys" : "");
+    }
+    if (options->varyInput) {
+        printf("input: varies from run to run\n");
+    }
+    if (options->measurement.flushCaches) {
+        printf("caches: flushed before each run\n");
+    }
+    // Times are of the runs after the warmup runs, memory, counts and
+    // counters of the last run.
+    printf("+-: 95%% confidence interval of the median, * if wider than "
+           "--precision\n");
+    printf("%-36s %-16s %10s %10s %12s %8s %12s %12s %12s %9s %5s %8s "
+           "%10s %12s %12s",
+           "algorithm", "order", "size", "k", "median ms", "+-%", "min ms",
+           "p90 ms", "MAD ms", "ns/nlg n", "runs", "outliers", "allocs",
+           "allocated", "peak");
+    if (options->comparison) {
+        printf(" %14s", "comparisons");
+    }
+    if (perf) {
+        printf(" %14s %14s %12s %12s", "cycles", "instructions",
+               "branch-miss", "cache-miss");
+    }
+    printf("\n");
+
+    for (const auto &algorithm : GetAlgorithms()) {
+        if (!algorithm.name.contains(options->algorithmPattern) ||
+            !options->filter.matches(algorithm)) {
+            continue;
+        }
+
+        for (auto order : options->orders) {
+            for (int size : options->sizes) {
+                if (!options->allSizes && !algorithm.recommendedFor(size)) {
+                    continue;
+                }
+
+                const auto items = generateVector(size, order, options->seed,
+                                                  options->swaps);
+                const auto k = options->selectK.forSize(size);
+                RunResult result;
+                const auto measurement = measure(
+                    options->measurement,
+                    [&](int run) -> std::optional<qint64> {
+                        result = runOnce(
+                            algorithm, options->keyType,
+                            options->varyInput && run > 0
+                                ? generateVector(size, order,
+                                                 options->seed + run,
+                                                 options->swaps)
+                                : items,
+                            k, perf ? &*perf : nullptr, options->comparison,
+                            options->measurement.flushCaches);
+                        if (!result.sorted) {
+                            return std::nullopt;
+                        }
+                        return result.nsecs;
+                    });
+
+                printf("%-36s %-16s %10d ",
+                       algorithm.name.toStdString().c_str(),
+                       arrayOrderName(order).toStdString().c_str(), size);
+                if (algorithm.selection == SelectionKind::None) {
+                    printf("%10s ", "-");
+                } else {
+                    printf("%10zu ", k);
+                }
+                if (!measurement) {
+                    printf("%12s %8s %12s %12s %12s %9s %5s %8s ",
+                           "NOT SORTED", "-", "-", "-", "-", "-", "-", "-");
+                    status = EXIT_FAILURE;
+                } else {
+                    const auto precision =
+                        QString::number(measurement->precision * 100, 'f',
+                                        2) +
+                        (measurement->converged ? "" : "*");
+                    printf("%12.3f %8s %12.3f %12.3f %12.3f %9.3f %5zu %8d ",
+                           measurement->median / 1e6, qPrintable(precision),
+                           measurement->min / 1e6, measurement->p90 / 1e6,
+                           measurement->mad / 1e6,
+                           measurement->nsPerNLogN(size),
+                           measurement->nsecs.size(), measurement->outliers);
+                }
+                printf("%10llu %12s %12s",
+                       (unsigned long long)result.memory.allocations,
+                       qPrintable(formatBytes(result.memory.bytesAllocated)),
+                       qPrintable(formatBytes(result.memory.peakBytes)));
+                if (options->comparison) {
+                    printf(" %14llu", (unsigned long long)result.comparisons);
+                }
+                if (perf) {
+                    const auto &counters = result.counters;
+                    printf(" %14s %14s %12s %12s",
+                           qPrintable(formatCount(counters.cycles)),
+                           qPrintable(formatCount(counters.instructions)),
+                           qPrintable(formatCount(counters.branchMisses)),
+                           qPrintable(formatCount(counters.cacheMisses)));
+                }
+                printf("\n");
+                fflush(stdout);
+            }
+        }
+    }
+
+    return status;
+}
+
+int RunCalibration(const QCommandLineParser &parser) {
+    auto options = parseOptions(parser);
+    if (!options) {
+        return EXIT_FAILURE;
+    }
+
+    // The table goes to stdout, so that it can be redirected to a file.
+    fprintf(stderr, "seed: %llu\n", (unsigned long long)options->seed);
+    fprintf(stderr, "topology: %s\n", qPrintable(describeTopology()));
+    fprintf(stderr, "placement: %s\n",
+            qPrintable(threadPlacement().toString()));
+
+    QVector<AutoRule> rules;
+    for (int i = 0; i < InputClassCount; i++) {
+        const auto input = static_cast<InputClass>(i);
+        for (const auto &sizeClass : autoSizeClasses()) {
+            const int size = sizeClass.calibrationSize;
+            const auto items = generateVector(size, inputClassOrder(input),
+                                              options->seed, options->swaps);
+
+            const std::vector<int> values(items.begin(), items.end());
+            const auto actual = classifyInput(analyzePresortedness(values));
+            if (actual != input) {
+                fprintf(stderr, "Warning: %s items of size %d look %s\n",
+                        qPrintable(inputClassName(input)), size,
+                        qPrintable(inputClassName(actual)));
+            }
+
+            // The median of each algorithm counts, so that timer
+            // resolution and noise don't decide.
+            const Algorithm *fastest = nullptr;
+            Measurement fastestMeasurement;
+            for (const auto &algorithm : GetAlgorithms()) {
+                if (!isAutoCandidate(algorithm) ||
+                    !algorithm.name.contains(options->algorithmPattern) ||
+                    !options->filter.matches(algorithm) ||
+                    (!options->allSizes && !algorithm.recommendedFor(size))) {
+                    continue;
+                }
+
+                const auto measurement = measure(
+                    options->measurement,
+                    [&](int) -> std::optional<qint64> {
+                        const auto result = runOnce(
+                            algorithm, KeyType::Item, items, size, nullptr,
+                            options->comparison,
+                            options->measurement.flushCaches);
+                        if (!result.sorted) {
+                            return std::nullopt;
+                        }
+                        return result.nsecs;
+                    });
+                if (!measurement) {
+                    fprintf(stderr, "%s didn't sort the items\n",
+                            qPrintable(algorithm.name));
+                    return EXIT_FAILURE;
+                }
+
+                if (!fastest ||
+                    measurement->median < fastestMeasurement.median) {
+                    fastest = &algorithm;
+                    fastestMeasurement = *measurement;
+                }
+            }
+
+            if (!fastest) {
+                fprintf(stderr, "No algorithm for %s items of size %d\n",
+                        qPrintable(inputClassName(input)), size);
+                return EXIT_FAILURE;
+            }
+            fprintf(stderr, "%-16s %10d %-36s %14.3f +-%.2f%%\n",
+                    qPrintable(inputClassName(input)), size,
+                    qPrintable(fastest->name),
+                    fastestMeasurement.median / 1e6,
+                    fastestMeasurement.precision * 100);
+            rules.append({input, sizeClass.maxSize, fastest->name});
+        }
+    }
+
+    printf("%s", qPrintable(formatAutoTable(rules)));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,15 @@
+/* -*- mode: c++; -*- */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+class QCommandLineParser;
+
+// Headless benchmark harness, run with --benchmark.
+void addBenchmarkOptions(QCommandLineParser &);
+int RunBenchmark(const QCommandLineParser &);
+
+// Benchmarks the algorithms Auto may pick on each class of inputs it
+// tells apart, and prints the fastest as a table for --auto-table.
+int RunCalibration(const QCommandLineParser &);
+
+#endif
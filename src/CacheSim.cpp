@@ -0,0 +1,145 @@
+#include "CacheSim.h"
+
+#include <QStringList>
+#include <algorithm>
+
+static constexpr auto InvalidTag = ~std::uintptr_t(0);
+
+double CacheLevelStats::hitRate() const {
+    const auto total = hits + misses;
+    return total ? double(hits) / total : 0.0;
+}
+
+QVector<CacheLevelConfig> defaultCacheLevels() {
+    return {
+        {.sizeBytes = 32 << 10, .ways = 8},
+        {.sizeBytes = 1 << 20, .ways = 16},
+        {.sizeBytes = 8 << 20, .ways = 16},
+    };
+}
+
+static std::optional<std::size_t> parseSize(QString str) {
+    std::size_t multiplier = 1;
+    if (str.endsWith('K', Qt::CaseInsensitive)) {
+        multiplier = 1 << 10;
+    } else if (str.endsWith('M', Qt::CaseInsensitive)) {
+        multiplier = 1 << 20;
+    }
+    if (multiplier != 1) {
+        str.chop(1);
+    }
+
+    bool ok;
+    const auto value = str.toULongLong(&ok);
+    if (!ok || value == 0) {
+        return std::nullopt;
+    }
+    return value * multiplier;
+}
+
+std::optional<QVector<CacheLevelConfig>>
+parseCacheLevels(const QString &spec) {
+    QVector<CacheLevelConfig> levels;
+
+    for (const auto &level : spec.split(',')) {
+        const auto fields = level.split(':');
+        if (fields.size() > 3) {
+            return std::nullopt;
+        }
+
+        CacheLevelConfig config{.sizeBytes = 0, .ways = 8};
+        if (auto size = parseSize(fields[0])) {
+            config.sizeBytes = *size;
+        } else {
+            return std::nullopt;
+        }
+        if (fields.size() > 1) {
+            bool ok;
+            config.ways = fields[1].toUInt(&ok);
+            if (!ok || config.ways == 0) {
+                return std::nullopt;
+            }
+        }
+        if (fields.size() > 2) {
+            if (auto line = parseSize(fields[2])) {
+                config.lineBytes = *line;
+            } else {
+                return std::nullopt;
+            }
+        }
+        if (config.sizeBytes < config.lineBytes * config.ways) {
+            return std::nullopt;
+        }
+
+        levels.append(config);
+    }
+
+    return levels;
+}
+
+CacheSimulator::CacheSimulator(const QVector<CacheLevelConfig> &levels)
+    : m_configs(levels) {
+    for (const auto &config : levels) {
+        Level level;
+        level.config = config;
+        level.numSets = config.sizeBytes / (config.lineBytes * config.ways);
+        level.tags.assign(level.numSets * config.ways, InvalidTag);
+        level.lastUse.assign(level.numSets * config.ways, 0);
+        m_levels.push_back(std::move(level));
+    }
+}
+
+bool CacheSimulator::Level::lookup(std::uintptr_t line, std::uint64_t now) {
+    const auto first = (line % numSets) * config.ways;
+    for (std::size_t i = first; i < first + config.ways; i++) {
+        if (tags[i] == line) {
+            lastUse[i] = now;
+            stats.hits++;
+            return true;
+        }
+    }
+    stats.misses++;
+    return false;
+}
+
+void CacheSimulator::Level::fill(std::uintptr_t line, std::uint64_t now) {
+    const auto first = (line % numSets) * config.ways;
+    const auto last = first + config.ways;
+    // Invalid entries have lastUse of 0, so they're evicted first.
+    const auto victim =
+        std::min_element(lastUse.begin() + first, lastUse.begin() + last) -
+        lastUse.begin();
+    tags[victim] = line;
+    lastUse[victim] = now;
+}
+
+int CacheSimulator::access(std::uintptr_t address) {
+    const auto now = ++m_clock;
+
+    int level = 0;
+    for (; level < int(m_levels.size()); level++) {
+        auto &cache = m_levels[level];
+        if (cache.lookup(address / cache.config.lineBytes, now)) {
+            break;
+        }
+    }
+
+    for (int i = 0; i < level; i++) {
+        auto &cache = m_levels[i];
+        cache.fill(address / cache.config.lineBytes, now);
+    }
+
+    return level;
+}
+
+const QVector<CacheLevelConfig> &CacheSimulator::levels() const {
+    return m_configs;
+}
+
+QVector<CacheLevelStats> CacheSimulator::stats() const {
+    QVector<CacheLevelStats> ret;
+    for (const auto &level : m_levels) {
+        ret.append(level.stats);
+    }
+    return ret;
+}
@@ -0,0 +1,64 @@
+/* -*- mode: c++; -*- */
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include <QString>
+#include <QVector>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct CacheLevelConfig {
+    std::size_t sizeBytes;
+    unsigned ways;
+    std::size_t lineBytes = 64;
+};
+
+struct CacheLevelStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+
+    double hitRate() const;
+};
+
+// Typical desktop hierarchy: 32 KiB L1, 1 MiB L2, 8 MiB LLC.
+QVector<CacheLevelConfig> defaultCacheLevels();
+
+// Parses a comma-separated list of levels, from L1 outwards, each
+// given as size[:ways[:line]], e.g. "32K:8,1M:16,8M:16:64".
+std::optional<QVector<CacheLevelConfig>> parseCacheLevels(const QString &);
+
+// Set-associative, LRU, inclusive cache hierarchy.  Every access
+// which misses a level is filled into it, so the model only depends
+// on the sequence of addresses.
+class CacheSimulator {
+  public:
+    CacheSimulator(const QVector<CacheLevelConfig> &levels);
+
+    // Returns the index of the level which had the line, or
+    // levels().size() if it had to be fetched from memory.
+    int access(std::uintptr_t address);
+
+    const QVector<CacheLevelConfig> &levels() const;
+    QVector<CacheLevelStats> stats() const;
+
+  private:
+    struct Level {
+        CacheLevelConfig config;
+        std::size_t numSets;
+        // numSets * ways entries, with the ways of a set next to each
+        // other.
+        std::vector<std::uintptr_t> tags;
+        std::vector<std::uint64_t> lastUse;
+        CacheLevelStats stats;
+
+        bool lookup(std::uintptr_t line, std::uint64_t now);
+        void fill(std::uintptr_t line, std::uint64_t now);
+    };
+
+    QVector<CacheLevelConfig> m_configs;
+    std::vector<Level> m_levels;
+    std::uint64_t m_clock = 0;
+};
+
+#endif
@@ -0,0 +1,72 @@
+/* -*- mode: c++; -*- */
+#ifndef COMPARISON_H
+#define COMPARISON_H
+
+#include "SortItem.h"
+
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// What comparing two items costs: ints compare in a cycle, while real
+// keys, e.g. strings compared with the locale's collation, can cost
+// far more, which changes which algorithms win.
+enum class ComparisonKind {
+    Int,
+    // Busy-waits for a fixed time, then compares the values as ints.
+    Spin,
+    // Collates a string derived from each value.
+    String,
+    // Compares a tuple of two ints and a string derived from each value.
+    Tuple,
+};
+
+struct ComparisonModel {
+    ComparisonKind kind = ComparisonKind::Int;
+    std::chrono::nanoseconds spin{0};
+    // Decorate-sort-undecorate: computes a byte string per item before
+    // sorting, which compares like the item, so that each comparison
+    // is a memcmp.
+    bool normalizedKeys = false;
+
+    // "int", "spin:NS", "string" or "tuple".
+    static std::optional<ComparisonModel> fromString(const QString &);
+    QString toString() const;
+};
+
+// Compares values as a ComparisonModel says, and counts comparisons.
+// Meant to be passed to SortItem::setComparator.
+class ModelComparator : public ValueComparator {
+  public:
+    // The items sorted must have values in [minValue, maxValue].
+    ModelComparator(const ComparisonModel &, int minValue, int maxValue);
+
+    std::strong_ordering compare(int, int) const override;
+
+    // Computes the normalized keys of the items, if the model uses
+    // them.  It's part of the sort, so callers time it.
+    void normalize(std::span<const SortItem>);
+
+    std::uint64_t comparisons() const { return m_comparisons; }
+
+  private:
+    using Tuple = std::tuple<int, int, std::string>;
+
+    std::string normalizedKey(std::size_t index) const;
+    void spin() const;
+
+    ComparisonModel m_model;
+    int m_minValue;
+    std::size_t m_count;
+    std::vector<std::string> m_strings;
+    std::vector<Tuple> m_tuples;
+    std::vector<std::string> m_keys;
+    mutable std::atomic<std::uint64_t> m_comparisons = 0;
+};
+
+#endif
@@ -0,0 +1,492 @@
+#include "Export.h"
+#include "Algorithms.h"
+#include "SortItem.h"
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <algorithm>
+#include <map>
+
+static const QRgb BackgroundColor = qRgb(128, 128, 128);
+static const QRgb ItemColor = qRgb(255, 255, 255);
+static const QRgb MarkedItemColor = qRgb(255, 0, 0);
+
+struct ExportOptions {
+    QString path;
+    bool y4m = false;
+    const Algorithm *algorithm = nullptr;
+    int size = 0;
+    ArrayOrder order = ArrayOrder::Random;
+    int opsPerFrame = 0;
+    QSize frameSize;
+    int frameRate = 0;
+    std::uint64_t seed = 0;
+    std::optional<std::uint64_t> swaps;
+    SelectionK selectK;
+};
+
+void addExportOptions(QCommandLineParser &parser) {
+    parser.addOptions({
+        {"export",
+         "Record a run to a directory of PNG frames, or to a .y4m video, "
+         "and exit",
+         "path"},
+        {"export-algorithm", "Algorithm to record", "name", "QuickSort"},
+        {"export-size", "Number of items to sort in the recording", "size",
+         "1000"},
+        {"export-order", "Initial order of the items in the recording",
+         "order", "Random"},
+        {"ops-per-frame",
+         "Number of comparisons, reads and writes per recorded frame", "ops",
+         "1000"},
+        {"frame-size", "Size of the recorded frames", "WIDTHxHEIGHT",
+         "1280x720"},
+        {"frame-rate", "Frame rate of the recorded video", "fps", "60"},
+    });
+}
+
+static std::optional<ExportOptions>
+parseOptions(const QCommandLineParser &parser) {
+    ExportOptions options;
+
+    options.path = parser.value("export");
+    options.y4m = options.path.endsWith(".y4m");
+
+    const auto name = parser.value("export-algorithm");
+    for (const auto &algorithm : GetAlgorithms()) {
+        if (algorithm.name == name) {
+            options.algorithm = &algorithm;
+        }
+    }
+    if (!options.algorithm) {
+        fprintf(stderr, "Unknown algorithm: %s\n", qPrintable(name));
+        return std::nullopt;
+    }
+
+    bool ok;
+    options.size = parser.value("export-size").toInt(&ok);
+    if (!ok || options.size < 0) {
+        fprintf(stderr, "Invalid size: %s\n",
+                qPrintable(parser.value("export-size")));
+        return std::nullopt;
+    }
+
+    const auto order = arrayOrderFromName(parser.value("export-order"));
+    if (!order) {
+        fprintf(stderr, "Invalid order: %s\n",
+                qPrintable(parser.value("export-order")));
+        return std::nullopt;
+    }
+    options.order = *order;
+
+    options.opsPerFrame = parser.value("ops-per-frame").toInt(&ok);
+    if (!ok || options.opsPerFrame <= 0) {
+        fprintf(stderr, "Invalid ops per frame: %s\n",
+                qPrintable(parser.value("ops-per-frame")));
+        return std::nullopt;
+    }
+
+    const auto dimensions = parser.value("frame-size").split('x');
+    bool okHeight = false;
+    ok = false;
+    if (dimensions.size() == 2) {
+        options.frameSize = QSize(dimensions[0].toInt(&ok),
+                                  dimensions[1].toInt(&okHeight));
+    }
+    // Y4M can't represent odd sizes with subsampled chroma, which many
+    // players assume, so only allow even ones.
+    if (!ok || !okHeight || options.frameSize.width() <= 0 ||
+        options.frameSize.height() <= 0 || options.frameSize.width() % 2 ||
+        options.frameSize.height() % 2) {
+        fprintf(stderr, "Invalid frame size: %s\n",
+                qPrintable(parser.value("frame-size")));
+        return std::nullopt;
+    }
+
+    options.frameRate = parser.value("frame-rate").toInt(&ok);
+    if (!ok || options.frameRate <= 0) {
+        fprintf(stderr, "Invalid frame rate: %s\n",
+                qPrintable(parser.value("frame-rate")));
+        return std::nullopt;
+    }
+
+    options.seed = randomSeed();
+    if (parser.isSet("seed")) {
+        options.seed = parser.value("seed").toULongLong(&ok);
+        if (!ok) {
+            fprintf(stderr, "Invalid seed: %s\n",
+                    qPrintable(parser.value("seed")));
+            return std::nullopt;
+        }
+    }
+    options.swaps = swapsOption(parser);
+
+    const auto selectK = SelectionK::fromString(parser.value("select-k"));
+    if (!selectK) {
+        fprintf(stderr, "Invalid k: %s\n",
+                qPrintable(parser.value("select-k")));
+        return std::nullopt;
+    }
+    options.selectK = *selectK;
+
+    return options;
+}
+
+// State of the array after some number of operations.
+struct Snapshot {
+    int number;
+    std::vector<int> values;
+    // Items accessed since the previous snapshot.
+    std::vector<std::uint32_t> marked;
+};
+
+// Draws items as bars when each gets at least one column, otherwise as
+// one dot per item.
+static QImage renderFrame(const Snapshot &snapshot, int maxValue,
+                          QSize size) {
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(BackgroundColor);
+
+    const int width = size.width(), height = size.height();
+    const auto numItems = snapshot.values.size();
+    if (numItems == 0) {
+        return image;
+    }
+
+    std::vector<QRgb *> lines(height);
+    for (int y = 0; y < height; y++) {
+        lines[y] = reinterpret_cast<QRgb *>(image.scanLine(y));
+    }
+
+    auto top = [&](int value) {
+        return height - 1 -
+               int(std::int64_t(value) * (height - 1) / std::max(maxValue, 1));
+    };
+
+    if (numItems <= std::size_t(width)) {
+        auto drawBar = [&](std::size_t i, QRgb color) {
+            const int x0 = i * width / numItems;
+            const int x1 = std::max<int>(x0 + 1, (i + 1) * width / numItems);
+            for (int y = std::max(0, top(snapshot.values[i])); y < height;
+                 y++) {
+                std::fill(lines[y] + x0, lines[y] + x1, color);
+            }
+        };
+        for (std::size_t i = 0; i < numItems; i++) {
+            drawBar(i, ItemColor);
+        }
+        for (auto i : snapshot.marked) {
+            drawBar(i, MarkedItemColor);
+        }
+    } else {
+        auto drawDot = [&](std::size_t i, QRgb color) {
+            const int y = std::clamp(top(snapshot.values[i]), 0, height - 1);
+            lines[y][i * width / numItems] = color;
+        };
+        for (std::size_t i = 0; i < numItems; i++) {
+            drawDot(i, ItemColor);
+        }
+        for (auto i : snapshot.marked) {
+            drawDot(i, MarkedItemColor);
+        }
+    }
+
+    return image;
+}
+
+static QByteArray y4mHeader(QSize size, int frameRate) {
+    return QString("YUV4MPEG2 W%1 H%2 F%3:1 Ip A1:1 C444\n")
+        .arg(size.width())
+        .arg(size.height())
+        .arg(frameRate)
+        .toLatin1();
+}
+
+// BT.601 limited range, without chroma subsampling.
+static QByteArray y4mFrame(const QImage &image) {
+    const int width = image.width(), height = image.height();
+    const qsizetype planeSize = qsizetype(width) * height;
+    const QByteArray frameHeader("FRAME\n");
+
+    QByteArray frame(frameHeader.size() + 3 * planeSize, Qt::Uninitialized);
+    std::copy(frameHeader.begin(), frameHeader.end(), frame.begin());
+    auto *y = reinterpret_cast<uchar *>(frame.data()) + frameHeader.size();
+    auto *u = y + planeSize;
+    auto *v = u + planeSize;
+
+    for (int row = 0; row < height; row++) {
+        const auto *line =
+            reinterpret_cast<const QRgb *>(image.constScanLine(row));
+        for (int col = 0; col < width; col++) {
+            const int r = qRed(line[col]), g = qGreen(line[col]),
+                      b = qBlue(line[col]);
+            *y++ = (66 * r + 129 * g + 25 * b + 128) / 256 + 16;
+            *u++ = (-38 * r - 74 * g + 112 * b + 128) / 256 + 128;
+            *v++ = (112 * r - 94 * g - 18 * b + 128) / 256 + 128;
+        }
+    }
+
+    return frame;
+}
+
+// Renders snapshots in a thread pool and writes them out in order.
+class FrameWriter {
+  public:
+    FrameWriter(const ExportOptions &options, int maxValue)
+        : m_options(options), m_maxValue(maxValue),
+          m_inFlight(2 * QThread::idealThreadCount()) {
+        m_pool.setMaxThreadCount(QThread::idealThreadCount());
+    }
+
+    bool open() {
+        if (!m_options.y4m) {
+            if (!QDir().mkpath(m_options.path)) {
+                fprintf(stderr, "Can't create directory: %s\n",
+                        qPrintable(m_options.path));
+                return false;
+            }
+            return true;
+        }
+
+        m_file.setFileName(m_options.path);
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            fprintf(stderr, "Can't open %s\n", qPrintable(m_options.path));
+            return false;
+        }
+        m_file.write(y4mHeader(m_options.frameSize, m_options.frameRate));
+        return true;
+    }
+
+    // Called from the sorting thread.  Blocks while too many frames
+    // are waiting to be rendered or written, which bounds memory use.
+    void submit(Snapshot snapshot) {
+        m_inFlight.acquire();
+        m_pool.start([this, snapshot = std::move(snapshot)] {
+            const auto image =
+                renderFrame(snapshot, m_maxValue, m_options.frameSize);
+            QByteArray data;
+            bool ok = true;
+            if (m_options.y4m) {
+                data = y4mFrame(image);
+            } else {
+                const auto fileName =
+                    QString("frame%1.png").arg(snapshot.number, 6, 10, '0');
+                ok = image.save(QDir(m_options.path).filePath(fileName));
+            }
+
+            QMutexLocker<QMutex> lock(&m_mutex);
+            m_done.emplace(snapshot.number, std::make_pair(ok, data));
+            m_frameDone.wakeAll();
+        });
+    }
+
+    // Called from the sorting thread after the last frame.
+    void finish(int numFrames) {
+        QMutexLocker<QMutex> lock(&m_mutex);
+        m_numFrames = numFrames;
+        m_frameDone.wakeAll();
+    }
+
+    // Writes frames in order until finish() was called and all frames
+    // were written.  Returns false if any frame couldn't be written.
+    bool writeAll() {
+        bool ok = true;
+        int next = 0;
+        QMutexLocker<QMutex> lock(&m_mutex);
+        while (m_numFrames < 0 || next < m_numFrames) {
+            auto it = m_done.find(next);
+            if (it == m_done.end()) {
+                m_frameDone.wait(&m_mutex);
+                continue;
+            }
+            auto [frameOk, data] = std::move(it->second);
+            m_done.erase(it);
+            lock.unlock();
+
+            if (m_options.y4m && frameOk) {
+                frameOk = m_file.write(data) == data.size();
+            }
+            if (!frameOk && ok) {
+                fprintf(stderr, "Failed to write frame %d\n", next);
+                ok = false;
+            }
+            next++;
+            m_inFlight.release();
+
+            lock.relock();
+        }
+        m_pool.waitForDone();
+        return ok;
+    }
+
+  private:
+    const ExportOptions &m_options;
+    const int m_maxValue;
+    QThreadPool m_pool;
+    QSemaphore m_inFlight;
+    QFile m_file;
+
+    QMutex m_mutex;
+    QWaitCondition m_frameDone;
+    // Rendered frames which weren't written yet, with whether
+    // rendering succeeded and the Y4M data.
+    std::map<int, std::pair<bool, QByteArray>> m_done;
+    int m_numFrames = -1;
+};
+
+// Takes a snapshot of the array every opsPerFrame operations.
+class Recorder : public SortItemCallbacks {
+  public:
+    Recorder(const std::vector<SortItem> &vec, int opsPerFrame,
+             FrameWriter &writer)
+        : m_vector(vec), m_opsPerFrame(opsPerFrame), m_writer(writer) {
+        for (const auto &item : vec) {
+            m_values.push_back(item.value());
+        }
+    }
+
+    void onComparison(const SortItem &lhs, const SortItem &rhs) override {
+        mark(lhs);
+        mark(rhs);
+        operation();
+    }
+
+    void onAccess(const SortItem &item) override {
+        mark(item);
+        operation();
+    }
+
+    void onAssignment(const SortItem &item, int /*oldValue*/, int newValue,
+                      const SortItem & /*from*/, ItemTransfer) override {
+        assign(item, newValue);
+        operation();
+    }
+
+    // Block operations are one operation, so that they show up in one
+    // frame.
+    void onRangeCopy(std::span<const SortItem> to,
+                     std::span<const SortItem> from, ItemTransfer) override {
+        for (std::size_t i = 0; i < to.size(); i++) {
+            assign(to[i], valueOf(from[i]));
+        }
+        operation();
+    }
+
+    void onRotate(std::span<const SortItem> items,
+                  std::size_t middle) override {
+        for (std::size_t i = 0; i < items.size(); i++) {
+            assign(items[i], valueOf(items[(i + middle) % items.size()]));
+        }
+        operation();
+    }
+
+    void onSwapRanges(std::span<const SortItem> a,
+                      std::span<const SortItem> b) override {
+        for (std::size_t i = 0; i < a.size(); i++) {
+            assign(a[i], valueOf(b[i]));
+            assign(b[i], valueOf(a[i]));
+        }
+        operation();
+    }
+
+    void snapshot() {
+        m_writer.submit({m_numFrames++, m_values, std::move(m_marked)});
+        m_marked.clear();
+        m_ops = 0;
+    }
+
+    int numFrames() const { return m_numFrames; }
+
+  private:
+    std::optional<std::size_t> indexInVector(const SortItem &item) const {
+        if (&item < m_vector.data() ||
+            &item >= m_vector.data() + m_vector.size()) {
+            return std::nullopt;
+        }
+        return &item - m_vector.data();
+    }
+
+    void assign(const SortItem &item, int value) {
+        if (auto index = indexInVector(item)) {
+            m_values[*index] = value;
+        }
+        mark(item);
+    }
+
+    void mark(const SortItem &item) {
+        if (auto index = indexInVector(item)) {
+            m_marked.push_back(*index);
+        }
+    }
+
+    void operation() {
+        if (++m_ops == m_opsPerFrame) {
+            snapshot();
+        }
+    }
+
+    const std::vector<SortItem> &m_vector;
+    const int m_opsPerFrame;
+    FrameWriter &m_writer;
+
+    std::vector<int> m_values;
+    std::vector<std::uint32_t> m_marked;
+    int m_ops = 0;
+    int m_numFrames = 0;
+};
+
+int RunExport(const QCommandLineParser &parser) {
+    const auto options = parseOptions(parser);
+    if (!options) {
+        return EXIT_FAILURE;
+    }
+
+    printf("seed: %llu\n", (unsigned long long)options->seed);
+    if (options->swaps) {
+        printf("swaps: %llu\n", (unsigned long long)*options->swaps);
+    }
+    auto vec = generateVector(options->size, options->order, options->seed,
+                              options->swaps);
+    const auto k = options->selectK.forSize(vec.size());
+    int maxValue = 0;
+    for (const auto &item : vec) {
+        maxValue = std::max(maxValue, item.value());
+    }
+
+    FrameWriter writer(*options, maxValue);
+    if (!writer.open()) {
+        return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<QThread> thread(QThread::create([&] {
+        Recorder recorder(vec, options->opsPerFrame, writer);
+        // The first frame shows the initial order.
+        recorder.snapshot();
+        SortItem::setCallbacksForCurrentThread(&recorder);
+        options->algorithm->run(vec, k);
+        SortItem::setCallbacksForCurrentThread(nullptr);
+        // The last frame shows the result, without marks.
+        recorder.snapshot();
+        recorder.snapshot();
+        writer.finish(recorder.numFrames());
+    }));
+    thread->start();
+
+    const bool ok = writer.writeAll();
+    thread->wait();
+
+    if (!options->algorithm->isDone(vec, k)) {
+        fprintf(stderr, "%s didn't sort the items\n",
+                qPrintable(options->algorithm->name));
+        return EXIT_FAILURE;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,12 @@
+/* -*- mode: c++; -*- */
+#ifndef EXPORT_H
+#define EXPORT_H
+
+class QCommandLineParser;
+
+// Headless recording of a run to PNG frames or a Y4M video, run with
+// --export.
+void addExportOptions(QCommandLineParser &);
+int RunExport(const QCommandLineParser &);
+
+#endif
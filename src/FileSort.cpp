@@ -0,0 +1,588 @@
+#include "FileSort.h"
+#include "Algorithms.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+enum class FileFormat {
+    Binary,
+    Csv,
+    Tsv,
+};
+
+static std::optional<FileFormat> fileFormatFromName(const QString &name) {
+    if (name == "binary") {
+        return FileFormat::Binary;
+    }
+    if (name == "csv") {
+        return FileFormat::Csv;
+    }
+    if (name == "tsv") {
+        return FileFormat::Tsv;
+    }
+    return std::nullopt;
+}
+
+struct FileSortOptions {
+    QString input;
+    QString output;
+    bool inPlace = false;
+    FileFormat format = FileFormat::Binary;
+    KeyType keyType = KeyType::Int32;
+    // Size of the records of binary files, or 0 if they are just keys.
+    qint64 recordSize = 0;
+    qint64 keyOffset = 0;
+    // Index of the column holding the key in CSV and TSV files.
+    int column = 0;
+    bool header = false;
+    const Algorithm *algorithm = nullptr;
+};
+
+void addFileSortOptions(QCommandLineParser &parser) {
+    parser.addOptions({
+        {"sort",
+         "Sort keys or records read from a file, or from stdin for -, and "
+         "exit",
+         "file"},
+        {"output",
+         "Write the data sorted with --sort to a file, or to stdout for -",
+         "file"},
+        {"sort-in-place", "Sort the binary file given to --sort in place"},
+        {"format", "Format of the file given to --sort: binary, csv or tsv",
+         "format", "binary"},
+        {"record-size",
+         "Size of the records of binary files, if they hold more than a key",
+         "bytes"},
+        {"key-offset", "Offset of the key in the records of binary files",
+         "bytes", "0"},
+        {"column", "Column holding the key in CSV and TSV files, from 1",
+         "column", "1"},
+        {"header", "Keep the first line of CSV and TSV files in place"},
+        {"sort-algorithm", "Algorithm to sort files with", "name",
+         "std::sort"},
+    });
+}
+
+static std::optional<FileSortOptions>
+parseOptions(const QCommandLineParser &parser) {
+    FileSortOptions options;
+
+    options.input = parser.value("sort");
+    options.output = parser.value("output");
+    options.inPlace = parser.isSet("sort-in-place");
+    options.header = parser.isSet("header");
+
+    const auto format = fileFormatFromName(parser.value("format"));
+    if (!format) {
+        fprintf(stderr, "Invalid format: %s\n",
+                qPrintable(parser.value("format")));
+        return std::nullopt;
+    }
+    options.format = *format;
+
+    // Items are ints, so sort files of them as such.
+    const auto keyType = keyTypeFromName(parser.value("key-type"));
+    if (!keyType) {
+        fprintf(stderr, "Invalid key type: %s\n",
+                qPrintable(parser.value("key-type")));
+        return std::nullopt;
+    }
+    options.keyType = *keyType == KeyType::Item ? KeyType::Int32 : *keyType;
+
+    const auto name = parser.value("sort-algorithm");
+    for (const auto &algorithm : GetAlgorithms()) {
+        if (algorithm.name == name) {
+            options.algorithm = &algorithm;
+        }
+    }
+    if (!options.algorithm) {
+        fprintf(stderr, "Unknown algorithm: %s\n", qPrintable(name));
+        return std::nullopt;
+    }
+    if (!options.algorithm->supports(options.keyType)) {
+        fprintf(stderr, "%s can't sort %s keys\n", qPrintable(name),
+                qPrintable(keyTypeName(options.keyType)));
+        return std::nullopt;
+    }
+
+    bool ok;
+    const qint64 keySize = options.keyType == KeyType::Int64 ? 8 : 4;
+    if (parser.isSet("record-size")) {
+        options.recordSize = parser.value("record-size").toLongLong(&ok);
+        if (!ok || options.recordSize < keySize) {
+            fprintf(stderr, "Invalid record size: %s\n",
+                    qPrintable(parser.value("record-size")));
+            return std::nullopt;
+        }
+    }
+    options.keyOffset = parser.value("key-offset").toLongLong(&ok);
+    if (!ok || options.keyOffset < 0 ||
+        options.keyOffset + keySize > std::max(options.recordSize, keySize)) {
+        fprintf(stderr, "Invalid key offset: %s\n",
+                qPrintable(parser.value("key-offset")));
+        return std::nullopt;
+    }
+
+    options.column = parser.value("column").toInt(&ok) - 1;
+    if (!ok || options.column < 0) {
+        fprintf(stderr, "Invalid column: %s\n",
+                qPrintable(parser.value("column")));
+        return std::nullopt;
+    }
+
+    if (options.inPlace &&
+        (options.input == "-" || options.format != FileFormat::Binary)) {
+        fprintf(stderr, "Only binary files can be sorted in place\n");
+        return std::nullopt;
+    }
+    if (options.output == options.input && options.output != "-") {
+        // Truncating the output would pull the input from under us.
+        fprintf(stderr, "Use --sort-in-place to sort a file in place\n");
+        return std::nullopt;
+    }
+
+    return options;
+}
+
+// The contents of the input file, mapped into memory, or read from
+// stdin.
+class InputFile {
+  public:
+    bool open(const QString &path, bool writable) {
+        if (path == "-") {
+            if (!m_file.open(stdin, QIODevice::ReadOnly)) {
+                fprintf(stderr, "Can't read stdin: %s\n",
+                        qPrintable(m_file.errorString()));
+                return false;
+            }
+            m_buffer = m_file.readAll();
+            m_data = std::span(m_buffer.data(), m_buffer.size());
+            return true;
+        }
+
+        m_file.setFileName(path);
+        if (!m_file.open(writable ? QIODevice::ReadWrite
+                                  : QIODevice::ReadOnly)) {
+            fprintf(stderr, "Can't open %s: %s\n", qPrintable(path),
+                    qPrintable(m_file.errorString()));
+            return false;
+        }
+        const auto size = m_file.size();
+        if (size == 0) {
+            return true;
+        }
+        // Pages of a private mapping are only copied when sorting writes
+        // to them, and never written back.
+        auto *data = m_file.map(0, size,
+                                writable ? QFileDevice::NoOptions
+                                         : QFileDevice::MapPrivateOption);
+        if (!data) {
+            fprintf(stderr, "Can't map %s: %s\n", qPrintable(path),
+                    qPrintable(m_file.errorString()));
+            return false;
+        }
+        m_data = std::span(reinterpret_cast<char *>(data), size);
+        return true;
+    }
+
+    std::span<char> data() const { return m_data; }
+
+  private:
+    QFile m_file;
+    QByteArray m_buffer;
+    std::span<char> m_data;
+};
+
+static bool openOutput(QFile &file, const QString &path) {
+    if (path == "-") {
+        return file.open(stdout, QIODevice::WriteOnly);
+    }
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        fprintf(stderr, "Can't open %s: %s\n", qPrintable(path),
+                qPrintable(file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+static bool write(QFile &file, std::string_view data) {
+    return file.write(data.data(), data.size()) == qint64(data.size());
+}
+
+// Writes records in the given order, each followed by a line break if
+// newlines is set.
+template <typename RecordAt>
+static bool writeRecords(QFile &file, const std::vector<std::size_t> &order,
+                         const RecordAt &recordAt, bool newlines) {
+    for (auto i : order) {
+        if (!write(file, recordAt(i)) || (newlines && !write(file, "\n"))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Key>
+static const std::function<void(std::span<Key>)> &
+kernel(const Algorithm &algorithm) {
+    if constexpr (std::is_same_v<Key, std::int32_t>) {
+        return algorithm.sortInt32;
+    } else if constexpr (std::is_same_v<Key, std::int64_t>) {
+        return algorithm.sortInt64;
+    } else {
+        return algorithm.sortFloat;
+    }
+}
+
+template <typename Key> static bool isValidKey(Key key) {
+    if constexpr (std::is_floating_point_v<Key>) {
+        return !std::isnan(key);
+    }
+    return true;
+}
+
+template <typename Key>
+static bool sortKeys(std::span<Key> keys, const Algorithm &algorithm) {
+    if (!std::all_of(keys.begin(), keys.end(), isValidKey<Key>)) {
+        fprintf(stderr, "NaN keys can't be sorted\n");
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    kernel<Key>(algorithm)(keys);
+    const auto nsecs = timer.nsecsElapsed();
+
+    if (!std::is_sorted(keys.begin(), keys.end())) {
+        fprintf(stderr, "%s didn't sort the keys\n",
+                qPrintable(algorithm.name));
+        return false;
+    }
+    fprintf(stderr, "Sorted %zu keys with %s in %.3f ms\n", keys.size(),
+            qPrintable(algorithm.name), nsecs / 1e6);
+    return true;
+}
+
+// Order of the records with the given keys when sorted, given the same
+// keys in sorted order.  Records with equal keys keep their order.
+template <typename Key>
+static std::optional<std::vector<std::size_t>>
+sortedOrder(std::span<const Key> keys, std::span<const Key> sortedKeys) {
+    std::vector<std::size_t> order(keys.size()), numPlaced(keys.size());
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        const std::size_t first =
+            std::lower_bound(sortedKeys.begin(), sortedKeys.end(), keys[i]) -
+            sortedKeys.begin();
+        const auto position = first + numPlaced[first]++;
+        if (position >= keys.size() || sortedKeys[position] != keys[i]) {
+            fprintf(stderr, "The keys were changed while sorting\n");
+            return std::nullopt;
+        }
+        order[position] = i;
+    }
+    return order;
+}
+
+// Sorts the keys, then orders the records by them.
+template <typename Key>
+static std::optional<std::vector<std::size_t>>
+sortRecords(std::span<const Key> keys, const Algorithm &algorithm) {
+    std::vector<Key> sortedKeys(keys.begin(), keys.end());
+    if (!sortKeys<Key>(sortedKeys, algorithm)) {
+        return std::nullopt;
+    }
+    return sortedOrder<Key>(keys, sortedKeys);
+}
+
+template <typename Key>
+static std::vector<Key> readRecordKeys(std::span<const char> data,
+                                       qint64 recordSize, qint64 keyOffset) {
+    std::vector<Key> keys(data.size() / recordSize);
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        // Keys in records needn't be aligned.
+        std::memcpy(&keys[i], data.data() + i * recordSize + keyOffset,
+                    sizeof(Key));
+    }
+    return keys;
+}
+
+template <typename Key>
+static bool sortBinary(std::span<char> data, const FileSortOptions &options,
+                       QFile *output) {
+    const qint64 recordSize =
+        options.recordSize ? options.recordSize : sizeof(Key);
+    if (data.size() % recordSize) {
+        fprintf(stderr, "Size %zu isn't a multiple of the record size %lld\n",
+                data.size(), (long long)recordSize);
+        return false;
+    }
+
+    if (recordSize == sizeof(Key)) {
+        // Sorted right in the mapped file.
+        std::span keys(reinterpret_cast<Key *>(data.data()),
+                       data.size() / sizeof(Key));
+        if (!sortKeys(keys, *options.algorithm)) {
+            return false;
+        }
+        return !output || write(*output, {data.data(), data.size()});
+    }
+
+    const auto keys = readRecordKeys<Key>(data, recordSize, options.keyOffset);
+    const auto order = sortRecords<Key>(keys, *options.algorithm);
+    if (!order) {
+        return false;
+    }
+
+    auto recordAt = [&](std::size_t i) {
+        return std::string_view(data.data() + i * recordSize, recordSize);
+    };
+    if (options.inPlace) {
+        std::vector<char> sorted;
+        sorted.reserve(data.size());
+        for (auto i : *order) {
+            const auto record = recordAt(i);
+            sorted.insert(sorted.end(), record.begin(), record.end());
+        }
+        std::copy(sorted.begin(), sorted.end(), data.begin());
+    }
+    return !output || writeRecords(*output, *order, recordAt, false);
+}
+
+// Removes the first line from text and returns it, without its line
+// break.
+static std::string_view takeLine(std::string_view &text) {
+    auto end = text.find('\n');
+    auto line = text.substr(0, end);
+    text.remove_prefix(end == text.npos ? text.size() : end + 1);
+    if (line.ends_with('\r')) {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+// Returns a field of a line of a CSV or TSV file.  CSV fields may be
+// quoted.
+static std::optional<std::string_view>
+field(std::string_view line, char delimiter, int column) {
+    std::size_t position = 0;
+    for (int i = 0;; i++) {
+        std::size_t begin = position, end;
+        if (delimiter == ',' && position < line.size() &&
+            line[position] == '"') {
+            // Quotes in quoted fields are doubled.
+            begin = end = position + 1;
+            while (end < line.size() &&
+                   (line[end] != '"' ||
+                    (end + 1 < line.size() && line[end + 1] == '"'))) {
+                end += line[end] == '"' ? 2 : 1;
+            }
+            position = line.find(delimiter, end);
+        } else {
+            position = line.find(delimiter, begin);
+            end = position == line.npos ? line.size() : position;
+        }
+
+        if (i == column) {
+            return line.substr(begin, std::min(end, line.size()) - begin);
+        }
+        if (position == line.npos) {
+            return std::nullopt;
+        }
+        position++;
+    }
+}
+
+template <typename Key>
+static std::optional<Key> parseKey(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+
+    Key key;
+    const auto end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars(text.data(), end, key);
+    if (ec != std::errc() || ptr != end || !isValidKey(key)) {
+        return std::nullopt;
+    }
+    return key;
+}
+
+template <typename Key>
+static std::optional<Key> lineKey(std::string_view line, char delimiter,
+                                  int column) {
+    const auto text = field(line, delimiter, column);
+    return text ? parseKey<Key>(*text) : std::nullopt;
+}
+
+template <typename Key>
+static bool sortLines(std::span<const char> data,
+                      const FileSortOptions &options, QFile *output) {
+    const char delimiter = options.format == FileFormat::Csv ? ',' : '\t';
+
+    std::string_view text(data.data(), data.size());
+    std::string_view header;
+    if (options.header) {
+        header = takeLine(text);
+    }
+
+    std::vector<std::string_view> lines;
+    std::vector<Key> keys;
+    while (!text.empty()) {
+        lines.push_back(takeLine(text));
+        const auto key = lineKey<Key>(lines.back(), delimiter, options.column);
+        if (!key) {
+            fprintf(stderr, "Line %zu has no %s key in column %d\n",
+                    lines.size() + options.header,
+                    qPrintable(keyTypeName(options.keyType)),
+                    options.column + 1);
+            return false;
+        }
+        keys.push_back(*key);
+    }
+
+    const auto order = sortRecords<Key>(keys, *options.algorithm);
+    if (!order) {
+        return false;
+    }
+    if (!output) {
+        return true;
+    }
+    if (options.header && (!write(*output, header) || !write(*output, "\n"))) {
+        return false;
+    }
+    return writeRecords(
+        *output, *order, [&](std::size_t i) { return lines[i]; }, true);
+}
+
+template <typename Key> static int sortFile(const FileSortOptions &options) {
+    InputFile input;
+    if (!input.open(options.input, options.inPlace)) {
+        return EXIT_FAILURE;
+    }
+
+    QFile outputFile;
+    QFile *output = nullptr;
+    if (!options.output.isEmpty()) {
+        if (!openOutput(outputFile, options.output)) {
+            return EXIT_FAILURE;
+        }
+        output = &outputFile;
+    }
+
+    const bool ok = options.format == FileFormat::Binary
+                        ? sortBinary<Key>(input.data(), options, output)
+                        : sortLines<Key>(input.data(), options, output);
+    if (output && !output->flush()) {
+        fprintf(stderr, "Can't write the output: %s\n",
+                qPrintable(output->errorString()));
+        return EXIT_FAILURE;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int RunFileSort(const QCommandLineParser &parser) {
+    const auto options = parseOptions(parser);
+    if (!options) {
+        return EXIT_FAILURE;
+    }
+
+    switch (options->keyType) {
+    case KeyType::Int32:
+        return sortFile<std::int32_t>(*options);
+    case KeyType::Int64:
+        return sortFile<std::int64_t>(*options);
+    case KeyType::Float:
+        return sortFile<float>(*options);
+    case KeyType::Item:
+        break;
+    }
+    return EXIT_FAILURE;
+}
+
+QStringList fileSampleFormats() {
+    return {"int32", "int64", "float", "csv", "tsv"};
+}
+
+// Number of smaller keys for each key.
+template <typename Key>
+static std::vector<int> ranks(const std::vector<Key> &keys) {
+    auto sorted = keys;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<int> ret;
+    for (auto key : keys) {
+        ret.push_back(std::lower_bound(sorted.begin(), sorted.end(), key) -
+                      sorted.begin());
+    }
+    return ret;
+}
+
+template <typename Key>
+static std::vector<int> binarySample(QFile &file, int maxItems) {
+    const auto data = file.read(qint64(maxItems) * sizeof(Key));
+    auto keys = readRecordKeys<Key>(std::span(data.data(), data.size()),
+                                    sizeof(Key), 0);
+    std::erase_if(keys, [](Key key) { return !isValidKey(key); });
+    return ranks(keys);
+}
+
+std::optional<std::vector<int>> loadFileSample(const QString &path,
+                                               const QString &format,
+                                               int maxItems, QString *error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return std::nullopt;
+    }
+
+    std::vector<int> values;
+    if (format == "csv" || format == "tsv") {
+        const auto size = file.size();
+        const auto *data = size ? file.map(0, size) : nullptr;
+        if (size && !data) {
+            *error = file.errorString();
+            return std::nullopt;
+        }
+
+        // Doubles hold keys of all types well enough to be looked at.
+        std::string_view text(reinterpret_cast<const char *>(data), size);
+        const char delimiter = format == "csv" ? ',' : '\t';
+        std::vector<double> keys;
+        while (!text.empty() && keys.size() < std::size_t(maxItems)) {
+            const auto line = takeLine(text);
+            for (int column = 0; auto value = field(line, delimiter, column);
+                 column++) {
+                if (auto key = parseKey<double>(*value)) {
+                    keys.push_back(*key);
+                    break;
+                }
+            }
+        }
+        values = ranks(keys);
+    } else if (format == "int32") {
+        values = binarySample<std::int32_t>(file, maxItems);
+    } else if (format == "int64") {
+        values = binarySample<std::int64_t>(file, maxItems);
+    } else if (format == "float") {
+        values = binarySample<float>(file, maxItems);
+    } else {
+        *error = QString("Unknown format: %1").arg(format);
+        return std::nullopt;
+    }
+
+    if (values.empty()) {
+        *error = QString("%1 holds no %2 keys").arg(path).arg(format);
+        return std::nullopt;
+    }
+    return values;
+}
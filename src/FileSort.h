@@ -0,0 +1,29 @@
+/* -*- mode: c++; -*- */
+#ifndef FILESORT_H
+#define FILESORT_H
+
+#include <QString>
+#include <QStringList>
+#include <optional>
+#include <vector>
+
+class QCommandLineParser;
+
+// Headless sorting of keys or records read from a file, run with
+// --sort.
+void addFileSortOptions(QCommandLineParser &);
+int RunFileSort(const QCommandLineParser &);
+
+// Names of the formats loadFileSample() reads: binary keys of a key
+// type, or CSV or TSV files.
+QStringList fileSampleFormats();
+
+// Reads up to maxItems keys from the start of a file to visualize them.
+// The key of a line of a CSV or TSV file is its first number; lines
+// without one, e.g. headers, are skipped.  Returns the ranks of the
+// keys, which compare like the keys themselves.
+std::optional<std::vector<int>> loadFileSample(const QString &path,
+                                               const QString &format,
+                                               int maxItems, QString *error);
+
+#endif
@@ -0,0 +1,85 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+
+static constexpr double DefaultRefreshRate = 60;
+// Share of the frame time that applying and painting changes may take.
+static constexpr double RenderBudget = 0.5;
+// Requests the next frame anyway if the view doesn't repaint, e.g.
+// because it's hidden.
+static constexpr int PaintTimeoutMsecs = 250;
+
+FramePacer::FramePacer(QObject *parent)
+    : QObject(parent), m_intervalNsecs(1e9 / DefaultRefreshRate) {
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(requestFrame()));
+}
+
+void FramePacer::setRefreshRate(double hz) {
+    if (hz > 0) {
+        m_intervalNsecs = 1e9 / hz;
+    }
+}
+
+void FramePacer::start() {
+    m_active = true;
+    m_waitingForPaint = false;
+    m_frameStart.invalidate();
+    m_timer.start(0);
+}
+
+void FramePacer::stop() {
+    m_active = false;
+    m_timer.stop();
+}
+
+void FramePacer::frameApplied(bool repaintExpected, qint64 applyNsecs) {
+    if (!m_active) {
+        return;
+    }
+
+    m_timings.applyNsecs = applyNsecs;
+    if (repaintExpected) {
+        m_waitingForPaint = true;
+        m_timer.start(PaintTimeoutMsecs);
+    } else {
+        m_timings.paintNsecs = 0;
+        emit timingsChanged(m_timings);
+        scheduleNextFrame();
+    }
+}
+
+FrameTimings FramePacer::timings() const { return m_timings; }
+
+void FramePacer::framePainted(qint64 paintNsecs) {
+    if (!m_active || !m_waitingForPaint) {
+        return;
+    }
+
+    m_waitingForPaint = false;
+    m_timings.paintNsecs = paintNsecs;
+    emit timingsChanged(m_timings);
+    scheduleNextFrame();
+}
+
+void FramePacer::requestFrame() {
+    if (!m_active) {
+        return;
+    }
+
+    if (m_frameStart.isValid()) {
+        m_timings.frameNsecs = m_frameStart.nsecsElapsed();
+    }
+    m_frameStart.start();
+    m_waitingForPaint = false;
+    emit frameRequested();
+}
+
+void FramePacer::scheduleNextFrame() {
+    const qint64 renderNsecs = m_timings.applyNsecs + m_timings.paintNsecs;
+    const qint64 periodNsecs =
+        std::max<qint64>(m_intervalNsecs, renderNsecs / RenderBudget);
+    const qint64 remainingNsecs = periodNsecs - m_frameStart.nsecsElapsed();
+    m_timer.start(std::max<qint64>(0, remainingNsecs / 1000000));
+}
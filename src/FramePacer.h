@@ -0,0 +1,63 @@
+/* -*- mode: c++; -*- */
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+struct FrameTimings {
+    // Time between the starts of the last two frames.
+    qint64 frameNsecs = 0;
+    // Time spent applying the changes of the last frame to the scene,
+    // and painting them.
+    qint64 applyNsecs = 0;
+    qint64 paintNsecs = 0;
+};
+
+// Requests frames in step with the repaints of a view: a frame is
+// requested once the previous one was painted, but no sooner than the
+// display's refresh interval.  When applying and painting a frame
+// takes more than half of the frame time, frames are spaced further
+// apart, so the changes of several frames are coalesced into one and
+// the event loop keeps time for input.
+class FramePacer : public QObject {
+    Q_OBJECT
+
+  public:
+    FramePacer(QObject *parent = nullptr);
+
+    void setRefreshRate(double hz);
+
+    void start();
+    void stop();
+
+    // Reports that the requested frame was applied to the scene.  If
+    // repaintExpected is false nothing changed, and the next frame is
+    // requested after the refresh interval.
+    void frameApplied(bool repaintExpected, qint64 applyNsecs);
+
+    FrameTimings timings() const;
+
+  public slots:
+    void framePainted(qint64 paintNsecs);
+
+  signals:
+    void frameRequested();
+    void timingsChanged(const FrameTimings &);
+
+  private slots:
+    void requestFrame();
+
+  private:
+    void scheduleNextFrame();
+
+    QTimer m_timer;
+    QElapsedTimer m_frameStart;
+    qint64 m_intervalNsecs;
+    bool m_active = false;
+    bool m_waitingForPaint = false;
+    FrameTimings m_timings;
+};
+
+#endif
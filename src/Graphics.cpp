@@ -1,19 +1,40 @@
 #include "Graphics.h"
 #include <QGraphicsItem>
+#include <QElapsedTimer>
 #include <QGraphicsView>
+#include <QPainter>
 #include <QPen>
 #include <QWheelEvent>
 
 static constexpr int ITEM_WIDTH = 100;
 static constexpr int ITEM_HEIGHT_MULT = 100;
 static constexpr int ITEM_BORDER_WIDTH = 5;
+// Height of the heatmap strip under the bars, relative to theirs.
+static constexpr int HEATMAP_HEIGHT_DIVISOR = 10;
+// Height of the auxiliary buffer lanes, relative to the bars.
+static constexpr int LANE_HEIGHT_DIVISOR = 4;
+// Enough for the 10 buckets of the radix sorts and a few more buffers.
+// Further buffers aren't drawn, so that lanes don't dwarf the bars.
+static constexpr int MAX_LANES = 16;
 
 static const auto ItemBrush = QBrush(Qt::white);
 static const auto MarkedItemBrush = QBrush(Qt::red);
+
+// Marked items when simulating caches, by the level the access was
+// served from.  Levels past L3 share the last colour.
+static const QBrush CacheLevelBrushes[] = {
+    QBrush(Qt::green),
+    QBrush(Qt::yellow),
+    QBrush(QColor(255, 140, 0)),
+};
+static const auto MemoryAccessBrush = QBrush(Qt::red);
 static const auto ItemPen = QPen(QBrush(Qt::black), ITEM_BORDER_WIDTH);
 
 static const auto Background = QBrush(Qt::darkGray);
 
+// Where the frame timings are drawn, in viewport coordinates.
+static const QRectF FrameTimingsBox(5, 5, 150, 50);
+
 GraphicsView::GraphicsView(QWidget *parent) : QGraphicsView(parent) {
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
@@ -37,6 +58,49 @@ void GraphicsView::setAntialiasingEnabled(bool enabled) {
     setRenderHint(QPainter::Antialiasing, enabled);
 }
 
+void GraphicsView::setFrameTimings(const FrameTimings &timings) {
+    m_frameTimings = timings;
+    if (m_frameTimingsVisible) {
+        viewport()->update(FrameTimingsBox.toAlignedRect());
+    }
+}
+
+void GraphicsView::setFrameTimingsVisible(bool visible) {
+    m_frameTimingsVisible = visible;
+    viewport()->update();
+}
+
+void GraphicsView::paintEvent(QPaintEvent *event) {
+    QElapsedTimer timer;
+    timer.start();
+    QGraphicsView::paintEvent(event);
+    emit framePainted(timer.nsecsElapsed());
+}
+
+void GraphicsView::drawForeground(QPainter *painter, const QRectF &) {
+    if (!m_frameTimingsVisible) {
+        return;
+    }
+
+    const auto &t = m_frameTimings;
+    const double fps = t.frameNsecs ? 1e9 / t.frameNsecs : 0;
+    const auto text =
+        QString("Frame: %1 ms (%2 fps)\nApply: %3 ms\nPaint: %4 ms")
+            .arg(t.frameNsecs / 1e6, 0, 'f', 1)
+            .arg(fps, 0, 'f', 0)
+            .arg(t.applyNsecs / 1e6, 0, 'f', 1)
+            .arg(t.paintNsecs / 1e6, 0, 'f', 1);
+
+    // In viewport coordinates, so it doesn't zoom with the scene.
+    painter->save();
+    painter->resetTransform();
+    painter->fillRect(FrameTimingsBox, QColor(0, 0, 0, 160));
+    painter->setPen(Qt::white);
+    painter->drawText(FrameTimingsBox.adjusted(5, 2, 0, 0),
+                      Qt::AlignLeft | Qt::AlignTop, text);
+    painter->restore();
+}
+
 void GraphicsView::resizeEvent(QResizeEvent *event) {
     fitItemsInView();
     QGraphicsView::resizeEvent(event);
@@ -76,19 +140,97 @@ void GraphicsView::wheelEvent(QWheelEvent *ev) {
     }
 }
 
+Sparkline::Sparkline(QWidget *parent) : QWidget(parent) {}
+
+QSize Sparkline::sizeHint() const { return QSize(MaxValues, 30); }
+
+void Sparkline::addValue(double value) {
+    if (m_values.size() == MaxValues) {
+        m_values.removeFirst();
+    }
+    m_values.append(value);
+    update();
+}
+
+void Sparkline::clear() {
+    m_values.clear();
+    update();
+}
+
+void Sparkline::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+
+    const double max = m_values.empty()
+                           ? 0
+                           : *std::max_element(m_values.begin(), m_values.end());
+    if (m_values.size() < 2 || max <= 0) {
+        return;
+    }
+
+    // Newest value on the right edge.
+    const double dx = double(width() - 1) / (MaxValues - 1);
+    const double x0 = (MaxValues - m_values.size()) * dx;
+    QVector<QPointF> points;
+    for (int i = 0; i < m_values.size(); i++) {
+        points.append(QPointF(x0 + i * dx,
+                              (height() - 1) * (1 - m_values[i] / max)));
+    }
+
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(palette().text().color());
+    painter.drawPolyline(points.data(), points.size());
+}
+
 SceneChanges::SceneChanges(int numItemsInVector)
     : m_numItemsInVector(numItemsInVector) {}
 
 bool SceneChanges::empty() const {
-    return m_accesses.empty() && m_assignments.empty();
+    return m_accesses.empty() && m_assignments.empty() &&
+           m_lanes.added.empty() && m_lanes.removed.empty() &&
+           m_lanes.accesses.empty();
 }
 
 int SceneChanges::numItemsInVector() const { return m_numItemsInVector; }
 
-void SceneChanges::addAccess(QGraphicsItem *item) { m_accesses.insert(item); }
+void SceneChanges::addAccess(QGraphicsItem *item, int cacheLevel) {
+    m_accesses.insert(item);
+    addCacheLevel(item, cacheLevel);
+}
 
-void SceneChanges::addAssignment(QGraphicsItem *item, int value) {
+void SceneChanges::addAssignment(QGraphicsItem *item, int value,
+                                 int cacheLevel) {
     m_assignments[item] = value;
+    addCacheLevel(item, cacheLevel);
+}
+
+void SceneChanges::addCacheLevel(QGraphicsItem *item, int cacheLevel) {
+    if (cacheLevel == NotSimulated) {
+        return;
+    }
+    auto [it, inserted] = m_cacheLevels.try_emplace(item, cacheLevel);
+    if (!inserted) {
+        it->second = std::max(it->second, cacheLevel);
+    }
+}
+
+void SceneChanges::addLane(int lane, int size) {
+    m_lanes.added.emplace_back(lane, size);
+}
+
+void SceneChanges::removeLane(int lane) { m_lanes.removed.push_back(lane); }
+
+void SceneChanges::addLaneAccess(LaneItem item, int cacheLevel) {
+    auto [it, inserted] = m_lanes.accesses.try_emplace(item, cacheLevel);
+    if (!inserted) {
+        it->second = std::max(it->second, cacheLevel);
+    }
+}
+
+void SceneChanges::addLaneAssignment(LaneItem item, int value,
+                                     int cacheLevel) {
+    m_lanes.assignments[item] = value;
+    addLaneAccess(item, cacheLevel);
 }
 
 std::unordered_set<QGraphicsItem *> SceneChanges::drainAccesses() {
@@ -103,33 +245,125 @@ std::unordered_map<QGraphicsItem *, int> SceneChanges::drainAssignments() {
     return ret;
 }
 
+std::unordered_map<QGraphicsItem *, int> SceneChanges::drainCacheLevels() {
+    auto ret = std::move(m_cacheLevels);
+    m_cacheLevels.clear();
+    return ret;
+}
+
+SceneChanges::LaneChanges SceneChanges::drainLaneChanges() {
+    auto ret = std::move(m_lanes);
+    m_lanes = {};
+    return ret;
+}
+
+static const QBrush &markedItemBrush(int cacheLevel) {
+    if (cacheLevel == SceneChanges::NotSimulated) {
+        return MarkedItemBrush;
+    }
+    if (cacheLevel == SceneChanges::MemoryAccess) {
+        return MemoryAccessBrush;
+    }
+    constexpr int numBrushes = std::size(CacheLevelBrushes);
+    return CacheLevelBrushes[std::min(cacheLevel, numBrushes - 1)];
+}
+
+static const QBrush &markedItemBrush(
+    const std::unordered_map<QGraphicsItem *, int> &cacheLevels,
+    QGraphicsItem *item) {
+    auto it = cacheLevels.find(item);
+    return markedItemBrush(it == cacheLevels.end() ? SceneChanges::NotSimulated
+                                                   : it->second);
+}
+
+HeatmapItem::HeatmapItem(const QRectF &rect) : m_rect(rect) {}
+
+void HeatmapItem::setImage(const QImage &image) {
+    m_image = image;
+    update();
+}
+
+QRectF HeatmapItem::boundingRect() const { return m_rect; }
+
+void HeatmapItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *,
+                        QWidget *) {
+    if (!m_image.isNull()) {
+        painter->drawImage(m_rect, m_image);
+    }
+}
+
 void Scene::reset(std::vector<SortItem> &vector) {
-    clear();
+    for (auto *item : m_markedItems) {
+        unmarkItem(item);
+    }
     m_markedItems.clear();
+    for (auto &[id, lane] : m_lanes) {
+        qDeleteAll(lane.items);
+    }
+    m_lanes.clear();
+    m_laneSlotTaken.clear();
+    delete m_laneArea;
+    m_laneArea = nullptr;
+    delete m_heatmap;
+    m_heatmap = nullptr;
+    m_heatmapImage = QImage();
 
     setBackgroundBrush(Background);
 
-    int numItems = vector.size();
+    const int numItems = vector.size();
+
+    // Bars are reused, since creating them is what made resets slow.
+    // Unchanged geometry isn't updated again.
+    while (m_bars.size() > numItems) {
+        delete m_bars.takeLast();
+    }
+    while (m_bars.size() < numItems) {
+        m_bars.append(addRect(QRectF(), ItemPen, ItemBrush));
+    }
 
     for (int i = 0; i < numItems; i++) {
         auto &sortable = vector[i];
-        int value = sortable.value();
+        const int value = sortable.value();
+        auto *item = m_bars[i];
+
+        const QRectF rect(0, 0, ITEM_WIDTH,
+                          value * ITEM_HEIGHT_MULT + ITEM_HEIGHT_MULT);
+        item->setRect(rect);
+        item->setPos(i * ITEM_WIDTH,
+                     numItems * ITEM_HEIGHT_MULT - rect.height());
+        sortable.setGraphicsItem(item);
+    }
 
-        QRectF rect;
-        rect.setX(0);
-        rect.setY(0);
-        rect.setWidth(ITEM_WIDTH);
-        rect.setHeight(value * ITEM_HEIGHT_MULT + ITEM_HEIGHT_MULT);
+    m_numItems = numItems;
+    if (m_heatmapVisible) {
+        createHeatmapItem();
+    }
+}
 
-        auto x = i * ITEM_WIDTH;
-        auto y = numItems * ITEM_HEIGHT_MULT - rect.height();
+void Scene::createHeatmapItem() {
+    const double barsHeight = m_numItems * ITEM_HEIGHT_MULT;
+    m_heatmap = new HeatmapItem(QRectF(0, 0, m_numItems * ITEM_WIDTH,
+                                       barsHeight / HEATMAP_HEIGHT_DIVISOR));
+    m_heatmap->setPos(0, barsHeight + ITEM_HEIGHT_MULT);
+    m_heatmap->setImage(m_heatmapImage);
+    addItem(m_heatmap);
+}
 
-        auto *item = addRect(rect);
-        item->setPos(x, y);
+void Scene::setHeatmap(const QImage &image) {
+    m_heatmapImage = image;
+    if (m_heatmap) {
+        m_heatmap->setImage(image);
+    }
+}
 
-        item->setBrush(ItemBrush);
-        item->setPen(ItemPen);
-        sortable.setGraphicsItem(item);
+void Scene::setHeatmapVisible(bool visible) {
+    m_heatmapVisible = visible;
+    if (visible && !m_heatmap) {
+        createHeatmapItem();
+    } else if (!visible && m_heatmap) {
+        removeItem(m_heatmap);
+        delete m_heatmap;
+        m_heatmap = nullptr;
     }
 }
 
@@ -138,10 +372,48 @@ void Scene::applyChanges(SceneChanges &changes) {
 
     auto assignments = changes.drainAssignments();
     auto accesses = changes.drainAccesses();
+    auto cacheLevels = changes.drainCacheLevels();
+    auto lanes = changes.drainLaneChanges();
 
     for (auto *item : m_markedItems) {
         unmarkItem(item);
     }
+    m_markedItems.clear();
+
+    // Buffers which came and went since the last frame are never
+    // drawn.
+    const std::unordered_set<int> removedLanes(lanes.removed.begin(),
+                                               lanes.removed.end());
+    for (int lane : lanes.removed) {
+        removeLane(lane);
+    }
+    for (auto [lane, size] : lanes.added) {
+        if (!removedLanes.count(lane)) {
+            addLane(lane, size);
+        }
+    }
+
+    const double laneItemHeightMult =
+        double(ITEM_HEIGHT_MULT) / LANE_HEIGHT_DIVISOR;
+    for (auto &[laneItemKey, value] : lanes.assignments) {
+        auto *it = laneItem(laneItemKey);
+        if (!it) {
+            continue;
+        }
+        auto r = it->rect();
+        r.setHeight((value + 1) * laneItemHeightMult);
+        auto pos = it->pos();
+        pos.setY(laneTop(m_lanes.at(laneItemKey.first).slot) +
+                 numItems * laneItemHeightMult - r.height());
+        it->setPos(pos);
+        it->setRect(r);
+        it->setVisible(true);
+    }
+    for (auto &[laneItemKey, cacheLevel] : lanes.accesses) {
+        if (auto *it = laneItem(laneItemKey)) {
+            markItem(it, markedItemBrush(cacheLevel));
+        }
+    }
 
     for (auto &[item, value] : assignments) {
         QGraphicsRectItem *it = static_cast<QGraphicsRectItem *>(item);
@@ -154,18 +426,86 @@ void Scene::applyChanges(SceneChanges &changes) {
         it->setPos(pos);
         it->setRect(r);
 
-        markItem(it);
+        markItem(it, markedItemBrush(cacheLevels, item));
     }
 
     for (auto *item : accesses) {
         QGraphicsRectItem *it = static_cast<QGraphicsRectItem *>(item);
-        markItem(it);
+        markItem(it, markedItemBrush(cacheLevels, item));
+    }
+}
+
+double Scene::laneTop(int slot) const {
+    const double barsHeight = m_numItems * ITEM_HEIGHT_MULT;
+    const double laneHeight = barsHeight / LANE_HEIGHT_DIVISOR;
+    const double lanesTop = barsHeight + ITEM_HEIGHT_MULT +
+                            barsHeight / HEATMAP_HEIGHT_DIVISOR +
+                            ITEM_HEIGHT_MULT;
+    return lanesTop + slot * (laneHeight + ITEM_HEIGHT_MULT);
+}
+
+void Scene::addLane(int id, int size) {
+    auto &lane = m_lanes[id];
+
+    for (int slot = 0; slot < m_laneSlotTaken.size(); slot++) {
+        if (!m_laneSlotTaken[slot]) {
+            lane.slot = slot;
+            break;
+        }
+    }
+    if (lane.slot == -1 && m_laneSlotTaken.size() < MAX_LANES) {
+        lane.slot = m_laneSlotTaken.size();
+        m_laneSlotTaken.append(false);
+
+        const double bottom = laneTop(lane.slot + 1) - ITEM_HEIGHT_MULT;
+        if (!m_laneArea) {
+            m_laneArea = addRect(QRectF(), QPen(Qt::NoPen));
+        }
+        m_laneArea->setRect(
+            QRectF(0, laneTop(0), m_numItems * ITEM_WIDTH, bottom - laneTop(0)));
+        emit extentChanged();
+    }
+    if (lane.slot == -1) {
+        return;
+    }
+    m_laneSlotTaken[lane.slot] = true;
+
+    // Items are shown once something is written to them.
+    for (int i = 0; i < size; i++) {
+        auto *item = addRect(QRectF(0, 0, ITEM_WIDTH, 0));
+        item->setPos(i * ITEM_WIDTH, laneTop(lane.slot));
+        item->setBrush(ItemBrush);
+        item->setPen(ItemPen);
+        item->setVisible(false);
+        lane.items.append(item);
+    }
+}
+
+void Scene::removeLane(int id) {
+    auto it = m_lanes.find(id);
+    if (it == m_lanes.end()) {
+        return;
+    }
+    if (it->second.slot != -1) {
+        m_laneSlotTaken[it->second.slot] = false;
+    }
+    for (auto *item : it->second.items) {
+        delete item;
+    }
+    m_lanes.erase(it);
+}
+
+QGraphicsRectItem *Scene::laneItem(SceneChanges::LaneItem key) const {
+    auto it = m_lanes.find(key.first);
+    if (it == m_lanes.end() || key.second >= it->second.items.size()) {
+        return nullptr;
     }
+    return it->second.items[key.second];
 }
 
 void Scene::unmarkItem(QGraphicsRectItem *item) { item->setBrush(ItemBrush); }
 
-void Scene::markItem(QGraphicsRectItem *item) {
-    item->setBrush(MarkedItemBrush);
+void Scene::markItem(QGraphicsRectItem *item, const QBrush &brush) {
+    item->setBrush(brush);
     m_markedItems.push_back(item);
 }
@@ -5,9 +5,11 @@
 #include <QGraphicsScene>
 #include <QGraphicsView>
 
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "FramePacer.h"
 #include "SortItem.h"
 
 class GraphicsView : public QGraphicsView {
@@ -17,53 +19,167 @@ class GraphicsView : public QGraphicsView {
     GraphicsView(QWidget *parent = nullptr);
 
     void resetZoom();
-    void fitItemsInView();
 
   public slots:
+    void fitItemsInView();
     void setAntialiasingEnabled(bool enabled);
+    void setFrameTimings(const FrameTimings &);
+    void setFrameTimingsVisible(bool visible);
+
+  signals:
+    // Emitted after each repaint, with the time it took.
+    void framePainted(qint64 nsecs);
 
   protected:
+    void paintEvent(QPaintEvent *ev) override;
+    void drawForeground(QPainter *painter, const QRectF &rect) override;
     void resizeEvent(QResizeEvent *ev) override;
     void wheelEvent(QWheelEvent *ev) override;
 
   private:
     float m_zoomFactor = 1.0;
+    bool m_frameTimingsVisible = false;
+    FrameTimings m_frameTimings;
+};
+
+// Small line chart of the most recent values of a series.
+class Sparkline : public QWidget {
+    Q_OBJECT
+
+  public:
+    Sparkline(QWidget *parent = nullptr);
+
+    QSize sizeHint() const override;
+
+  public slots:
+    void addValue(double);
+    void clear();
+
+  protected:
+    void paintEvent(QPaintEvent *) override;
+
+  private:
+    static constexpr int MaxValues = 100;
+
+    QVector<double> m_values;
 };
 
 class SceneChanges {
   public:
+    // Cache levels of accesses, besides indices into the simulated
+    // hierarchy.
+    enum { NotSimulated = -1, MemoryAccess = 1000 };
+
     SceneChanges(int numItemsInVector);
 
     bool empty() const;
 
     int numItemsInVector() const;
-    void addAccess(QGraphicsItem *);
-    void addAssignment(QGraphicsItem *, int value);
+    void addAccess(QGraphicsItem *, int cacheLevel = NotSimulated);
+    void addAssignment(QGraphicsItem *, int value,
+                       int cacheLevel = NotSimulated);
+
+    // Auxiliary buffers are drawn as lanes under the array.  Items in
+    // a lane are identified by the lane and their index in it.
+    using LaneItem = std::pair<int, int>;
+
+    void addLane(int lane, int size);
+    void removeLane(int lane);
+    void addLaneAccess(LaneItem, int cacheLevel = NotSimulated);
+    void addLaneAssignment(LaneItem, int value, int cacheLevel = NotSimulated);
+
+    struct LaneChanges {
+        // Lane and size.
+        std::vector<std::pair<int, int>> added;
+        std::vector<int> removed;
+        std::map<LaneItem, int> assignments;
+        // Accessed and assigned items, with their cache level.
+        std::map<LaneItem, int> accesses;
+    };
 
     std::unordered_set<QGraphicsItem *> drainAccesses();
     std::unordered_map<QGraphicsItem *, int> drainAssignments();
+    // The outermost cache level each item was accessed from.
+    std::unordered_map<QGraphicsItem *, int> drainCacheLevels();
+    LaneChanges drainLaneChanges();
 
   private:
+    void addCacheLevel(QGraphicsItem *, int cacheLevel);
+
     int m_numItemsInVector;
 
     std::unordered_map<QGraphicsItem *, int> m_assignments;
     std::unordered_set<QGraphicsItem *> m_accesses;
+    std::unordered_map<QGraphicsItem *, int> m_cacheLevels;
+    LaneChanges m_lanes;
+};
+
+// Image stretched over a fixed rectangle of the scene.
+class HeatmapItem : public QGraphicsItem {
+  public:
+    HeatmapItem(const QRectF &rect);
+
+    void setImage(const QImage &);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *, const QStyleOptionGraphicsItem *,
+               QWidget *) override;
+
+  private:
+    QRectF m_rect;
+    QImage m_image;
 };
 
 class Scene : public QGraphicsScene {
     Q_OBJECT
 
   public:
+    // Shows the items of vec, reusing the bars of the previous items.
     void reset(std::vector<SortItem> &vec);
 
   public slots:
     void applyChanges(SceneChanges &);
+    void setHeatmap(const QImage &);
+    void setHeatmapVisible(bool);
+
+  signals:
+    // Emitted when the items no longer fit in the area of the scene
+    // they used so far.
+    void extentChanged();
 
   private:
+    struct Lane {
+        // -1 if all slots were taken when it was added, in which case
+        // it's not drawn.
+        int slot = -1;
+        QVector<QGraphicsRectItem *> items;
+    };
+
     void unmarkItem(QGraphicsRectItem *item);
-    void markItem(QGraphicsRectItem *item);
+    void markItem(QGraphicsRectItem *item, const QBrush &brush);
 
+    void createHeatmapItem();
+
+    void addLane(int lane, int size);
+    void removeLane(int lane);
+    QGraphicsRectItem *laneItem(SceneChanges::LaneItem) const;
+    double laneTop(int slot) const;
+
+    // Bars of the items of the vector, in its order.
+    QVector<QGraphicsRectItem *> m_bars;
     QVector<QGraphicsRectItem *> m_markedItems;
+
+    std::unordered_map<int, Lane> m_lanes;
+    QVector<bool> m_laneSlotTaken;
+    // Invisible, keeps the area of all slots used so far in the scene.
+    QGraphicsRectItem *m_laneArea = nullptr;
+
+    // Only in the scene while visible, so that it doesn't take space
+    // when hidden.
+    HeatmapItem *m_heatmap = nullptr;
+    bool m_heatmapVisible = true;
+    int m_numItems = 0;
+    QImage m_heatmapImage;
 };
 
 #endif
@@ -0,0 +1,55 @@
+#include "Heatmap.h"
+
+#include <QColor>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+AccessHeatmap::AccessHeatmap(std::size_t size)
+    : m_size(size), m_reads(new std::atomic<std::uint64_t>[size]()),
+      m_writes(new std::atomic<std::uint64_t>[size]()) {}
+
+std::size_t AccessHeatmap::size() const { return m_size; }
+
+void AccessHeatmap::addRead(std::size_t index) {
+    m_reads[index].fetch_add(1, std::memory_order_relaxed);
+}
+
+void AccessHeatmap::addWrite(std::size_t index) {
+    m_writes[index].fetch_add(1, std::memory_order_relaxed);
+}
+
+QImage AccessHeatmap::render(int maxWidth) const {
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    const int width = std::max<int>(1, std::min<std::size_t>(m_size, maxWidth));
+    std::vector<std::uint64_t> reads(width), writes(width);
+    for (std::size_t i = 0; i < m_size; i++) {
+        const auto x = i * width / m_size;
+        reads[x] += m_reads[i].load(relaxed);
+        writes[x] += m_writes[i].load(relaxed);
+    }
+
+    std::uint64_t max = 0;
+    for (int x = 0; x < width; x++) {
+        max = std::max(max, reads[x] + writes[x]);
+    }
+
+    QImage image(width, 1, QImage::Format_RGB32);
+    auto *pixels = reinterpret_cast<QRgb *>(image.scanLine(0));
+    const double logMax = std::log1p(double(max));
+    for (int x = 0; x < width; x++) {
+        const auto total = reads[x] + writes[x];
+        if (!total) {
+            pixels[x] = qRgb(0, 0, 0);
+            continue;
+        }
+        const double writeShare = double(writes[x]) / total;
+        const double brightness = std::log1p(double(total)) / logMax;
+        pixels[x] = QColor::fromHsv(int(240 * (1 - writeShare)), 255,
+                                    int(255 * brightness))
+                        .rgb();
+    }
+
+    return image;
+}
@@ -0,0 +1,33 @@
+/* -*- mode: c++; -*- */
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <QImage>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Reads and writes of each index of the sorted vector, accumulated
+// over a whole run.  May be updated from any number of threads.
+class AccessHeatmap {
+  public:
+    AccessHeatmap(std::size_t size);
+
+    std::size_t size() const;
+
+    void addRead(std::size_t index);
+    void addWrite(std::size_t index);
+
+    // Renders a strip of at most maxWidth pixels, each pixel summing
+    // the indices it covers.  Brightness is the log-scaled number of
+    // accesses, hue goes from blue to red as the share of writes
+    // grows.
+    QImage render(int maxWidth = 4096) const;
+
+  private:
+    std::size_t m_size;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_reads;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_writes;
+};
+
+#endif
@@ -1,11 +1,17 @@
 #include "MainWindow.h"
 
+#include <QFileDialog>
+#include <QFileInfo>
 #include <QGraphicsScene>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QStringListModel>
 #include <algorithm>
 #include <qnamespace.h>
 
 #include "Algorithms.h"
+#include "Auto.h"
+#include "FileSort.h"
 #include "Graphics.h"
 #include "SortItem.h"
 
@@ -14,10 +20,17 @@ MainWindow::MainWindow(QWidget *parent)
     m_ui->setupUi(this);
 
     const auto &algorithms = GetAlgorithms();
-    for (const auto &algo : algorithms) {
+    for (int i = 0; i < algorithms.size(); i++) {
+        const auto &algo = algorithms[i];
         QListWidgetItem *item = new QListWidgetItem(algo.name);
+        item->setData(Qt::UserRole, i);
+        item->setToolTip(algorithmToolTip(algo));
         m_ui->listWidgetAlgorithms->addItem(item);
         item->setSelected(true);
+
+        auto *scalingItem = new QListWidgetItem(*item);
+        m_ui->listWidgetScalingAlgorithms->addItem(scalingItem);
+        scalingItem->setSelected(false);
     }
     for (int i = 0; i < ArrayOrderCount; i++) {
         const ArrayOrder order = static_cast<ArrayOrder>(i);
@@ -26,7 +39,12 @@ MainWindow::MainWindow(QWidget *parent)
         item->setData(Qt::UserRole, static_cast<int>(i));
         m_ui->listWidgetItemOrder->addItem(item);
         item->setSelected(true);
+
+        auto *scalingItem = new QListWidgetItem(*item);
+        m_ui->listWidgetScalingOrders->addItem(scalingItem);
+        scalingItem->setSelected(order == ArrayOrder::Random);
     }
+    m_ui->chartScalingOperations->setMetric(ScalingChart::Metric::Operations);
 
     connect(m_ui->actionAntialiasing, SIGNAL(toggled(bool)), m_ui->graphicsView,
             SLOT(setAntialiasingEnabled(bool)));
@@ -38,8 +56,16 @@ MainWindow::MainWindow(QWidget *parent)
     connect(m_ui->listWidgetItemOrder,
             SIGNAL(currentItemChanged(QListWidgetItem *, QListWidgetItem *)),
             this, SLOT(onOrderSelected(QListWidgetItem *)));
+    connect(m_ui->lineEditSeed, SIGNAL(editingFinished()), this,
+            SLOT(onSeedEdited()));
+    connect(m_ui->toolButtonNewSeed, SIGNAL(clicked()), this,
+            SLOT(onNewSeedClicked()));
     connect(m_ui->pushButtonRunPauseResume, SIGNAL(clicked()), this,
             SLOT(onRunPauseResumeClicked()));
+    connect(m_ui->pushButtonStep, SIGNAL(clicked()), this,
+            SLOT(onStepClicked()));
+    connect(m_ui->pushButtonRunUntil, SIGNAL(clicked()), this,
+            SLOT(onRunUntilClicked()));
     connect(m_ui->pushButtonReset, SIGNAL(clicked()), this,
             SLOT(onResetClicked()));
     connect(m_ui->listWidgetItemOrder,
@@ -47,12 +73,32 @@ MainWindow::MainWindow(QWidget *parent)
             SLOT(onResetClicked()));
     connect(m_ui->dialDelay, SIGNAL(valueChanged(int)), this,
             SLOT(onDelayChanged(int)));
+    for (auto *checkBox :
+         {m_ui->checkBoxStableOnly, m_ui->checkBoxInPlaceOnly,
+          m_ui->checkBoxRecommendedOnly}) {
+        connect(checkBox, SIGNAL(toggled(bool)), this,
+                SLOT(onAlgorithmFilterChanged()));
+    }
+
+    connect(m_ui->actionLoadFile, SIGNAL(triggered()), this,
+            SLOT(onLoadFileTriggered()));
+    connect(m_ui->actionHeatmap, SIGNAL(toggled(bool)), this,
+            SLOT(onHeatmapToggled(bool)));
+    connect(m_ui->actionFrameTimings, SIGNAL(toggled(bool)),
+            m_ui->graphicsView, SLOT(setFrameTimingsVisible(bool)));
+    connect(m_ui->pushButtonScalingStartStop, SIGNAL(clicked()), this,
+            SLOT(onScalingStartStopClicked()));
 
-    m_ui->graphicsView->setScene(new Scene);
+    auto *scene = new Scene;
+    connect(scene, SIGNAL(extentChanged()), m_ui->graphicsView,
+            SLOT(fitItemsInView()));
+    m_ui->graphicsView->setScene(scene);
     m_ui->graphicsView->setAntialiasingEnabled(
         m_ui->actionAntialiasing->isEnabled());
 
     onNumItemsChanged(m_ui->spinBoxNumItems->value());
+    m_params.seed = randomSeed();
+    m_ui->lineEditSeed->setText(QString::number(m_params.seed));
     m_ui->listWidgetAlgorithms->setCurrentItem(
         m_ui->listWidgetAlgorithms->item(0));
     m_ui->listWidgetItemOrder->setCurrentItem(
@@ -61,7 +107,42 @@ MainWindow::MainWindow(QWidget *parent)
     setup();
 }
 
-MainWindow::~MainWindow() { delete m_ui; }
+MainWindow::~MainWindow() {
+    if (m_generator) {
+        m_generator->wait();
+    }
+    if (m_scaling) {
+        m_scaling->cancel();
+        m_scaling->wait();
+    }
+    delete m_ui;
+}
+
+QString MainWindow::algorithmToolTip(const Algorithm &algo) {
+    QStringList keyTypes;
+    for (auto type :
+         {KeyType::Item, KeyType::Int32, KeyType::Int64, KeyType::Float}) {
+        if (algo.supports(type)) {
+            keyTypes.append(keyTypeName(type));
+        }
+    }
+
+    QString sizes = QString::number(algo.minRecommendedSize) + " - ";
+    if (algo.maxRecommendedSize != std::numeric_limits<std::size_t>::max()) {
+        sizes += QString::number(algo.maxRecommendedSize);
+    }
+
+    return QString("Stable: %1\nIn-place: %2\nAuxiliary memory: %3\n"
+                   "Parallel: %4\nKey types: %5\nRecommended sizes: %6\n"
+                   "Result: %7")
+        .arg(algo.stable ? "yes" : "no")
+        .arg(algo.inPlace ? "yes" : "no")
+        .arg(auxMemoryName(algo.auxMemory))
+        .arg(algo.parallel ? "yes" : "no")
+        .arg(keyTypes.join(", "))
+        .arg(sizes)
+        .arg(selectionKindName(algo.selection));
+}
 
 void MainWindow::setup() {
     if (!m_params.algorithm) {
@@ -73,12 +154,78 @@ void MainWindow::setup() {
         delete m_run;
         m_run = nullptr;
     }
+    m_params.needsRegenerate = false;
+
+    const auto source = itemSource();
+    if (m_items && m_items->source == source) {
+        showItems();
+        return;
+    }
+    if (m_generator) {
+        // onItemsGenerated() comes back here.
+        return;
+    }
+
+    statusBar()->showMessage("Generating items...");
+    m_generator = QThread::create(
+        [this, source] { m_generatedItems = generateItems(source); });
+    connect(m_generator, SIGNAL(finished()), this, SLOT(onItemsGenerated()));
+    m_generator->start();
+}
+
+MainWindow::ItemSource MainWindow::itemSource() const {
+    ItemSource source;
+    source.numItems = m_params.numItems;
+    source.order = m_params.order;
+    source.seed = m_params.seed;
+    source.swaps = m_params.swaps;
+    source.samplePath = m_params.samplePath;
+    source.sampleFormat = m_params.sampleFormat;
+    return source;
+}
+
+MainWindow::GeneratedItems MainWindow::generateItems(const ItemSource &source) {
+    GeneratedItems items;
+    items.source = source;
+    if (!source.samplePath.isEmpty()) {
+        auto values = ::loadFileSample(source.samplePath, source.sampleFormat,
+                                       source.numItems, &items.error);
+        if (!values) {
+            return items;
+        }
+        items.values = std::move(*values);
+    } else {
+        items.values.resize(source.numItems);
+        generateValues(items.values, source.order, source.seed,
+                       source.swaps);
+    }
+    items.presortedness = analyzePresortedness(items.values);
+    return items;
+}
+
+void MainWindow::onItemsGenerated() {
+    m_generator->deleteLater();
+    m_generator = nullptr;
+    m_items = std::move(m_generatedItems);
+
+    if (m_items->error.isEmpty()) {
+        statusBar()->clearMessage();
+    } else {
+        // Falls back to generated items.
+        statusBar()->showMessage(m_items->error);
+        m_params.samplePath.clear();
+    }
+    setup();
+}
 
-    m_vector = generateVector(m_params.numItems, m_params.order);
+void MainWindow::showItems() {
+    m_vector =
+        std::vector<SortItem>(m_items->values.begin(), m_items->values.end());
 
     Scene *scene = qobject_cast<Scene *>(m_ui->graphicsView->scene());
 
     scene->reset(m_vector);
+    showPresortedness(m_items->presortedness);
 
     m_ui->graphicsView->fitItemsInView();
     m_ui->graphicsView->resetZoom();
@@ -90,51 +237,226 @@ void MainWindow::setup() {
             SLOT(applyChanges(SceneChanges &)));
     connect(m_run, SIGNAL(statsReady(Run::Stats)), this,
             SLOT(onStats(Run::Stats)));
+    connect(m_run, SIGNAL(heatmapReady(const QImage &)), scene,
+            SLOT(setHeatmap(const QImage &)));
+
+    auto *pacer = m_run->framePacer();
+    pacer->setRefreshRate(m_ui->graphicsView->screen()->refreshRate());
+    connect(m_ui->graphicsView, SIGNAL(framePainted(qint64)), pacer,
+            SLOT(framePainted(qint64)));
+    connect(pacer, SIGNAL(timingsChanged(const FrameTimings &)),
+            m_ui->graphicsView, SLOT(setFrameTimings(const FrameTimings &)));
 
     onRunStateChanged(Run::State::NotStarted);
+    m_ui->sparklineAccessRate->clear();
     onStats(Run::Stats{});
-    m_params.needsRegenerate = false;
+
+    if (m_whenItemsReady) {
+        std::exchange(m_whenItemsReady, {})();
+    }
+}
+
+void MainWindow::whenItemsReady(const std::function<void()> &action) {
+    if (m_params.needsRegenerate) {
+        setup();
+    }
+    if (m_run) {
+        action();
+    } else {
+        m_whenItemsReady = action;
+    }
+}
+
+bool MainWindow::runStarted() const {
+    return m_run && (m_run->state() == Run::State::Running ||
+                     m_run->state() == Run::State::Paused);
+}
+
+void MainWindow::showPresortedness(const Presortedness &presortedness) {
+    m_ui->labelRunsValue->setText(QString::number(presortedness.runs));
+    m_ui->labelInversionsValue->setText(
+        QString("%1 (%2%)")
+            .arg(presortedness.inversions)
+            .arg(presortedness.inversionRatio() * 100, 0, 'f', 1));
+    m_ui->labelMaxDisplacementValue->setText(
+        QString::number(presortedness.maxDisplacement));
+    m_ui->labelDuplicatesValue->setText(
+        QString("%1%").arg(presortedness.duplicateRatio * 100, 0, 'f', 1));
+    m_ui->labelAutoChoiceValue->setText(
+        QString("%1 (%2)")
+            .arg(autoChoice(presortedness).name)
+            .arg(inputClassName(classifyInput(presortedness))));
+}
+
+void MainWindow::setCacheLevels(const QVector<CacheLevelConfig> &levels) {
+    m_cacheLevels = levels;
+    m_ui->actionCacheSimulation->setChecked(true);
+}
+
+void MainWindow::setSeed(std::uint64_t seed) {
+    m_params.seed = seed;
+    m_ui->lineEditSeed->setText(QString::number(seed));
+    setup();
+}
+
+void MainWindow::setSwaps(std::uint64_t swaps) {
+    m_params.swaps = swaps;
+    setup();
 }
 
 void MainWindow::onNumItemsChanged(int numItems) {
     m_params.numItems = numItems;
     m_params.needsRegenerate = true;
+    m_ui->spinBoxSelectK->setMaximum(std::max(numItems, 1));
+    m_ui->spinBoxBreakIndex->setMaximum(std::max(numItems - 1, 0));
+    onAlgorithmFilterChanged();
 }
 
 void MainWindow::onOrderSelected(QListWidgetItem *item) {
+    if (!item) {
+        return;
+    }
+    m_params.samplePath.clear();
     m_params.order = static_cast<ArrayOrder>(item->data(Qt::UserRole).toInt());
     m_params.needsRegenerate = true;
 }
 
+void MainWindow::onSeedEdited() {
+    bool ok;
+    const auto seed = m_ui->lineEditSeed->text().toULongLong(&ok);
+    if (!ok) {
+        m_ui->lineEditSeed->setText(QString::number(m_params.seed));
+        return;
+    }
+    if (seed != m_params.seed) {
+        setSeed(seed);
+    }
+}
+
+void MainWindow::onNewSeedClicked() { setSeed(randomSeed()); }
+
+void MainWindow::onLoadFileTriggered() {
+    const auto path = QFileDialog::getOpenFileName(this, "Load items");
+    if (path.isEmpty()) {
+        return;
+    }
+
+    const auto formats = fileSampleFormats();
+    bool ok;
+    const auto format = QInputDialog::getItem(
+        this, "Load items", "Keys:", formats,
+        std::max<int>(0, formats.indexOf(QFileInfo(path).suffix())), false,
+        &ok);
+    if (!ok) {
+        return;
+    }
+
+    QString error;
+    const auto values = ::loadFileSample(
+        path, format, m_ui->spinBoxNumItems->maximum(), &error);
+    if (!values) {
+        QMessageBox::warning(this, "Load items", error);
+        return;
+    }
+
+    m_params.samplePath = path;
+    m_params.sampleFormat = format;
+    m_ui->listWidgetItemOrder->setCurrentItem(nullptr);
+    m_ui->spinBoxNumItems->setValue(values->size());
+    m_params.numItems = values->size();
+    setup();
+    statusBar()->showMessage(QString("Loaded %1 items from %2")
+                                 .arg(values->size())
+                                 .arg(QFileInfo(path).fileName()));
+}
+
 void MainWindow::onAlgorithmSelected(QListWidgetItem *item) {
-    m_params.algorithm =
-        &*std::ranges::find(GetAlgorithms(), item->text(), &Algorithm::name);
+    if (!item) {
+        return;
+    }
+    m_params.algorithm = &GetAlgorithms()[item->data(Qt::UserRole).toInt()];
+    m_ui->spinBoxSelectK->setEnabled(m_params.algorithm->selection !=
+                                     SelectionKind::None);
+}
+
+void MainWindow::onAlgorithmFilterChanged() {
+    AlgorithmFilter filter;
+    filter.stableOnly = m_ui->checkBoxStableOnly->isChecked();
+    filter.inPlaceOnly = m_ui->checkBoxInPlaceOnly->isChecked();
+    if (m_ui->checkBoxRecommendedOnly->isChecked()) {
+        filter.size = m_params.numItems;
+    }
+
+    const auto &algorithms = GetAlgorithms();
+    auto *list = m_ui->listWidgetAlgorithms;
+    for (int i = 0; i < list->count(); i++) {
+        auto *item = list->item(i);
+        const auto &algo = algorithms[item->data(Qt::UserRole).toInt()];
+        item->setHidden(!filter.matches(algo));
+    }
+}
+
+void MainWindow::onHeatmapToggled(bool enabled) {
+    Scene *scene = qobject_cast<Scene *>(m_ui->graphicsView->scene());
+    scene->setHeatmapVisible(enabled);
+    m_ui->graphicsView->fitItemsInView();
 }
 
 void MainWindow::onDelayChanged(int us) {
     m_params.delay = std::chrono::microseconds(us);
     m_ui->labelDelayValue->setText(QString::asprintf("%d us", us));
-    m_run->setDelay(m_params.delay);
+    if (m_run) {
+        m_run->setDelay(m_params.delay);
+    }
+}
+
+void MainWindow::startRun(bool paused) {
+    m_run->setCacheLevels(m_ui->actionCacheSimulation->isChecked()
+                              ? m_cacheLevels
+                              : QVector<CacheLevelConfig>());
+    m_run->setSelectionK(m_ui->spinBoxSelectK->value());
+    m_run->start(*m_params.algorithm, paused);
 }
 
 void MainWindow::onRunPauseResumeClicked() {
-    switch (m_run->state()) {
-    case Run::State::Finished:
-    case Run::State::NotStarted:
-        if (m_params.needsRegenerate) {
-            setup();
-        }
-        m_run->start(*m_params.algorithm);
-        break;
-    case Run::State::Paused:
+    if (!runStarted()) {
+        whenItemsReady([this] { startRun(); });
+    } else if (m_run->state() == Run::State::Paused) {
         m_run->resume();
-        break;
-    case Run::State::Running:
+    } else {
         m_run->pause();
-        break;
     }
 }
 
+void MainWindow::onStepClicked() {
+    const int ops = m_ui->spinBoxStepOps->value();
+    if (runStarted()) {
+        m_run->step(ops);
+        return;
+    }
+    whenItemsReady([this, ops] {
+        startRun(/*paused=*/true);
+        m_run->step(ops);
+    });
+}
+
+void MainWindow::onRunUntilClicked() {
+    Run::Breakpoint breakpoint;
+    breakpoint.operation = m_ui->comboBoxBreakOperation->currentIndex() == 0
+                               ? Run::Breakpoint::Operation::Assignment
+                               : Run::Breakpoint::Operation::Comparison;
+    breakpoint.index = m_ui->spinBoxBreakIndex->value();
+    if (runStarted()) {
+        m_run->runUntil(breakpoint);
+        return;
+    }
+    // Paused, so that the breakpoint is set before the first operation.
+    whenItemsReady([this, breakpoint] {
+        startRun(/*paused=*/true);
+        m_run->runUntil(breakpoint);
+    });
+}
+
 void MainWindow::onResetClicked() { setup(); }
 
 void MainWindow::onRunStateChanged(Run::State state) {
@@ -152,9 +474,91 @@ void MainWindow::onRunStateChanged(Run::State state) {
         m_ui->pushButtonRunPauseResume->setText("Resume");
         break;
     }
+    // A running run steps once paused.
+    m_ui->pushButtonStep->setEnabled(state != Run::State::Running);
 }
 
 void MainWindow::onStats(Run::Stats stats) {
-    m_ui->labelAccessesValue->setNum(stats.accesses);
-    m_ui->labelComparisonsValue->setNum(stats.comparisons);
+    m_ui->labelReadsValue->setText(QString::number(stats.reads));
+    m_ui->labelWritesValue->setText(QString::number(stats.writes));
+    m_ui->labelComparisonsValue->setText(QString::number(stats.comparisons));
+    m_ui->labelSwapsValue->setText(QString::number(stats.swaps));
+    m_ui->labelCopiesValue->setText(QString::number(stats.copies));
+    m_ui->labelMovesValue->setText(QString::number(stats.moves));
+    m_ui->labelAuxAccessesValue->setText(QString::number(stats.auxAccesses));
+    m_ui->labelAccessRateValue->setText(
+        QString::number(stats.accessesPerSecond, 'f', 0));
+    if (m_run && m_run->state() == Run::State::Running) {
+        m_ui->sparklineAccessRate->addValue(stats.accessesPerSecond);
+    }
+    m_ui->labelAllocationsValue->setText(
+        QString::number(stats.memory.allocations));
+    m_ui->labelAllocatedValue->setText(
+        formatBytes(stats.memory.bytesAllocated));
+    m_ui->labelPeakMemoryValue->setText(formatBytes(stats.memory.peakBytes));
+
+    QStringList hitRates;
+    for (int i = 0; i < stats.cache.size(); i++) {
+        hitRates.append(QString("L%1 %2%")
+                            .arg(i + 1)
+                            .arg(stats.cache[i].hitRate() * 100, 0, 'f', 1));
+    }
+    m_ui->labelCacheHitsValue->setText(hitRates.isEmpty() ? "Off"
+                                                          : hitRates.join(" "));
+}
+
+void MainWindow::onScalingStartStopClicked() {
+    if (m_scaling) {
+        // onScalingFinished() enables it again.
+        m_scaling->cancel();
+        m_ui->pushButtonScalingStartStop->setEnabled(false);
+        return;
+    }
+
+    ScalingPlan plan;
+    const auto &algorithms = GetAlgorithms();
+    for (auto *item : m_ui->listWidgetScalingAlgorithms->selectedItems()) {
+        plan.algorithms.append(&algorithms[item->data(Qt::UserRole).toInt()]);
+    }
+    for (auto *item : m_ui->listWidgetScalingOrders->selectedItems()) {
+        plan.orders.append(
+            static_cast<ArrayOrder>(item->data(Qt::UserRole).toInt()));
+    }
+    if (plan.algorithms.isEmpty() || plan.orders.isEmpty()) {
+        statusBar()->showMessage("Select algorithms and orders to measure");
+        return;
+    }
+    plan.minSize = m_ui->spinBoxScalingMinSize->value();
+    plan.maxSize =
+        std::max(plan.minSize, m_ui->spinBoxScalingMaxSize->value());
+    plan.factor = m_ui->doubleSpinBoxScalingFactor->value();
+    plan.seed = m_params.seed;
+    plan.swaps = m_params.swaps;
+    // Short enough to watch the curves grow.
+    plan.measurement.maxSeconds = 1;
+
+    m_ui->chartScalingTime->clear();
+    m_ui->chartScalingOperations->clear();
+    m_scaling = new ScalingWorker(plan, this);
+    connect(m_scaling, SIGNAL(pointReady(ScalingPoint)),
+            m_ui->chartScalingTime, SLOT(addPoint(ScalingPoint)));
+    connect(m_scaling, SIGNAL(pointReady(ScalingPoint)),
+            m_ui->chartScalingOperations, SLOT(addPoint(ScalingPoint)));
+    connect(m_scaling, SIGNAL(progress(int, int)), this,
+            SLOT(onScalingProgress(int, int)));
+    connect(m_scaling, SIGNAL(finished()), this, SLOT(onScalingFinished()));
+    m_ui->pushButtonScalingStartStop->setText("Stop");
+    m_scaling->start();
+}
+
+void MainWindow::onScalingProgress(int done, int total) {
+    m_ui->progressBarScaling->setMaximum(total);
+    m_ui->progressBarScaling->setValue(done);
+}
+
+void MainWindow::onScalingFinished() {
+    m_scaling->deleteLater();
+    m_scaling = nullptr;
+    m_ui->pushButtonScalingStartStop->setText("Start");
+    m_ui->pushButtonScalingStartStop->setEnabled(true);
 }
@@ -3,9 +3,14 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QThread>
+#include <functional>
 #include <memory>
 
+#include "CacheSim.h"
+#include "Presortedness.h"
 #include "Run.h"
+#include "Scaling.h"
 #include "SortItem.h"
 #include "ui_MainWindow.h"
 
@@ -20,31 +25,106 @@ class MainWindow : public QMainWindow {
 
     void setup();
 
+    // Hierarchy simulated when cache simulation is enabled.
+    void setCacheLevels(const QVector<CacheLevelConfig> &);
+
+    // Regenerates the items with this seed.
+    void setSeed(std::uint64_t);
+    // Regenerates the items with this number of SortedWithSwaps swaps.
+    void setSwaps(std::uint64_t);
+
   public slots:
     void onNumItemsChanged(int);
     void onOrderSelected(QListWidgetItem *);
+    void onSeedEdited();
+    void onNewSeedClicked();
+    void onLoadFileTriggered();
     void onAlgorithmSelected(QListWidgetItem *);
+    void onAlgorithmFilterChanged();
     void onDelayChanged(int);
+    void onHeatmapToggled(bool);
     void onRunPauseResumeClicked();
+    void onStepClicked();
+    void onRunUntilClicked();
     void onResetClicked();
 
     void onRunStateChanged(Run::State);
     void onStats(Run::Stats);
 
+    void onScalingStartStopClicked();
+    void onScalingProgress(int done, int total);
+
+  private slots:
+    void onItemsGenerated();
+    void onScalingFinished();
+
   private:
+    // What the items are generated or loaded from.
+    struct ItemSource {
+        int numItems = 0;
+        ArrayOrder order = ArrayOrder::Ascending;
+        std::uint64_t seed = 0;
+        std::optional<std::uint64_t> swaps;
+        QString samplePath;
+        QString sampleFormat;
+
+        bool operator==(const ItemSource &) const = default;
+    };
+
+    struct GeneratedItems {
+        ItemSource source;
+        std::vector<int> values;
+        Presortedness presortedness;
+        // Why the file couldn't be loaded, if it couldn't.
+        QString error;
+    };
+
+    static QString algorithmToolTip(const Algorithm &);
+    ItemSource itemSource() const;
+    // Runs on m_generator, off the GUI thread.
+    static GeneratedItems generateItems(const ItemSource &);
+    // Shows the generated items and sets up a run of them.
+    void showItems();
+    // Calls action once there is a run of the current items, which may
+    // have to be generated first.
+    void whenItemsReady(const std::function<void()> &action);
+    bool runStarted() const;
+    // Starts a new run, paused before the first operation if paused.
+    void startRun(bool paused = false);
+    // Shows how presorted the items are, and what Auto makes of it.
+    void showPresortedness(const Presortedness &);
+
     Ui_MainWindow *m_ui;
 
     struct {
         int numItems = 0;
         ArrayOrder order = ArrayOrder::Ascending;
+        std::uint64_t seed = 0;
+        std::optional<std::uint64_t> swaps;
+        // File and format of loadFileSample(), if items are loaded
+        // rather than generated.
+        QString samplePath;
+        QString sampleFormat;
         const Algorithm *algorithm = nullptr;
         std::chrono::microseconds delay = std::chrono::microseconds(0);
         bool needsRegenerate = false;
     } m_params;
 
     std::vector<SortItem> m_vector;
+    QVector<CacheLevelConfig> m_cacheLevels = defaultCacheLevels();
 
     Run *m_run = nullptr;
+
+    QThread *m_generator = nullptr;
+    // Written by m_generator while it runs.
+    GeneratedItems m_generatedItems;
+    // The latest generated items, which resets restore if they are
+    // still current.
+    std::optional<GeneratedItems> m_items;
+    std::function<void()> m_whenItemsReady;
+
+    // Measures the Scaling tab while it runs.
+    ScalingWorker *m_scaling = nullptr;
 };
 
 #endif
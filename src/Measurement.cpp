@@ -0,0 +1,180 @@
+#include "Measurement.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// Flushed if the size of the last level cache is unknown.
+static constexpr std::size_t DefaultFlushBytes = 64 << 20;
+static constexpr std::size_t CacheLineBytes = 64;
+
+// Two-sided 95% quantile of the normal distribution.
+static constexpr double Z95 = 1.96;
+
+// Iglewicz and Hoaglin's threshold for outliers.
+static constexpr double OutlierZScore = 3.5;
+
+void addMeasurementOptions(QCommandLineParser &parser) {
+    parser.addOptions({
+        {"warmup", "Runs of each benchmark which don't count", "count", "1"},
+        {"min-runs", "Runs of each benchmark, at least", "count", "5"},
+        {"max-runs", "Runs of each benchmark, at most", "count", "50"},
+        {"precision",
+         "Run benchmarks until the 95% confidence interval of their median "
+         "time is within this many percent of it",
+         "percent", "1"},
+        {"max-time",
+         "Stop running a benchmark after this many seconds, once it ran "
+         "--min-runs times",
+         "seconds", "10"},
+        {"flush-caches", "Flush the CPU caches before each run"},
+    });
+}
+
+std::optional<MeasurementOptions>
+parseMeasurementOptions(const QCommandLineParser &parser) {
+    MeasurementOptions options;
+
+    const std::pair<const char *, int *> counts[] = {
+        {"warmup", &options.warmup},
+        {"min-runs", &options.minRuns},
+        {"max-runs", &options.maxRuns},
+    };
+    for (const auto &[name, count] : counts) {
+        bool ok;
+        *count = parser.value(name).toInt(&ok);
+        if (!ok || *count < 0) {
+            fprintf(stderr, "Invalid %s: %s\n", name,
+                    qPrintable(parser.value(name)));
+            return std::nullopt;
+        }
+    }
+    if (options.minRuns == 0 || options.maxRuns < options.minRuns) {
+        fprintf(stderr, "Expected 0 < --min-runs <= --max-runs\n");
+        return std::nullopt;
+    }
+
+    bool ok;
+    options.precision = parser.value("precision").toDouble(&ok) / 100;
+    if (!ok || options.precision <= 0) {
+        fprintf(stderr, "Invalid precision: %s\n",
+                qPrintable(parser.value("precision")));
+        return std::nullopt;
+    }
+
+    options.maxSeconds = parser.value("max-time").toDouble(&ok);
+    if (!ok || options.maxSeconds < 0) {
+        fprintf(stderr, "Invalid time: %s\n",
+                qPrintable(parser.value("max-time")));
+        return std::nullopt;
+    }
+
+    options.flushCaches = parser.isSet("flush-caches");
+    return options;
+}
+
+double Measurement::nsPerNLogN(std::size_t n) const {
+    return n > 1 ? median / (n * std::log2(double(n))) : 0;
+}
+
+// Of sorted values.
+static double quantile(const std::vector<double> &sorted, double q) {
+    const auto rank = std::ceil(q * sorted.size()) - 1;
+    return sorted[std::clamp<std::size_t>(rank, 0, sorted.size() - 1)];
+}
+
+static double median(const std::vector<double> &sorted) {
+    const auto n = sorted.size();
+    return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+// The confidence interval of the median is distribution-free: its
+// bounds are the order statistics around n/2 within z * sqrt(n)/2.
+static void computeStatistics(Measurement &m) {
+    std::vector<double> sorted(m.nsecs.begin(), m.nsecs.end());
+    std::sort(sorted.begin(), sorted.end());
+    const auto n = sorted.size();
+
+    m.median = median(sorted);
+    m.min = sorted.front();
+    m.p90 = quantile(sorted, 0.9);
+
+    std::vector<double> deviations;
+    for (double value : sorted) {
+        deviations.push_back(std::abs(value - m.median));
+    }
+    std::sort(deviations.begin(), deviations.end());
+    m.mad = median(deviations);
+
+    const double spread = Z95 * std::sqrt(double(n)) / 2;
+    const auto lower = std::clamp<double>(std::floor(n / 2.0 - spread), 0,
+                                          n - 1);
+    const auto upper = std::clamp<double>(std::ceil(n / 2.0 + spread), 0,
+                                          n - 1);
+    m.precision = m.median > 0 ? (sorted[std::size_t(upper)] -
+                                  sorted[std::size_t(lower)]) /
+                                     2 / m.median
+                               : 0;
+
+    m.outliers = 0;
+    if (m.mad > 0) {
+        for (double value : sorted) {
+            m.outliers +=
+                0.6745 * std::abs(value - m.median) / m.mad > OutlierZScore;
+        }
+    }
+}
+
+std::optional<Measurement>
+measure(const MeasurementOptions &options,
+        const std::function<std::optional<qint64>(int run)> &run) {
+    for (int i = -options.warmup; i < 0; i++) {
+        if (!run(i)) {
+            return std::nullopt;
+        }
+    }
+
+    Measurement m;
+    QElapsedTimer elapsed;
+    elapsed.start();
+    for (int i = 0; i < options.maxRuns; i++) {
+        const auto nsecs = run(i);
+        if (!nsecs) {
+            return std::nullopt;
+        }
+        m.nsecs.push_back(*nsecs);
+
+        if (int(m.nsecs.size()) < options.minRuns) {
+            continue;
+        }
+        computeStatistics(m);
+        m.converged = m.precision <= options.precision;
+        if (m.converged || elapsed.elapsed() > options.maxSeconds * 1000) {
+            break;
+        }
+    }
+    return m;
+}
+
+static std::size_t flushBytes() {
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    const long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (l3 > 0) {
+        return std::max<std::size_t>(2 * l3, DefaultFlushBytes);
+    }
+#endif
+    return DefaultFlushBytes;
+}
+
+// Writing each line of the buffer reads it, too.
+void flushCaches() {
+    static std::vector<char> buffer(flushBytes());
+    for (std::size_t i = 0; i < buffer.size(); i += CacheLineBytes) {
+        buffer[i]++;
+    }
+}
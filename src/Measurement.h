@@ -0,0 +1,62 @@
+/* -*- mode: c++; -*- */
+#ifndef MEASUREMENT_H
+#define MEASUREMENT_H
+
+#include <QtGlobal>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <vector>
+
+class QCommandLineParser;
+
+// How often a benchmark runs: warmup runs, which don't count, then at
+// least minRuns runs, until the 95% confidence interval of the median
+// is within precision of it, or maxRuns or maxSeconds are reached.
+struct MeasurementOptions {
+    int warmup = 1;
+    int minRuns = 5;
+    int maxRuns = 50;
+    double precision = 0.01;
+    double maxSeconds = 10;
+    // Callers flush with flushCaches() after preparing the input of a
+    // run, just before timing it.
+    bool flushCaches = false;
+};
+
+void addMeasurementOptions(QCommandLineParser &);
+std::optional<MeasurementOptions>
+parseMeasurementOptions(const QCommandLineParser &);
+
+// Statistics of the counted runs, in nanoseconds.
+struct Measurement {
+    std::vector<qint64> nsecs;
+    double median = 0;
+    // Median absolute deviation from the median.
+    double mad = 0;
+    double min = 0;
+    double p90 = 0;
+    // Half-width of the 95% confidence interval of the median,
+    // relative to it.
+    double precision = 0;
+    bool converged = false;
+    // Runs whose modified z-score is above 3.5.
+    int outliers = 0;
+
+    // Median per n log2 n, which is flat for O(n log n) algorithms.
+    double nsPerNLogN(std::size_t n) const;
+};
+
+// Calls run with the index of the run, negative for warmup runs, which
+// returns the nanoseconds of its timed part, or nothing if it failed,
+// in which case measuring stops.  Runs prepare their input, e.g. copy
+// or generate it, outside of the timed part.
+std::optional<Measurement>
+measure(const MeasurementOptions &,
+        const std::function<std::optional<qint64>(int run)> &run);
+
+// Evicts the caches by writing a buffer larger than the last level
+// cache.
+void flushCaches();
+
+#endif
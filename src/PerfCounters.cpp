@@ -0,0 +1,141 @@
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <asm/unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+static int openCounter(std::uint64_t config, int groupFd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = groupFd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return syscall(__NR_perf_event_open, &attr, 0 /* this thread */,
+                   -1 /* any cpu */, groupFd, 0);
+}
+
+PerfCounters::PerfCounters() {
+    const std::uint64_t configs[NumCounters] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_MISSES,
+    };
+
+    m_fds[Cycles] = openCounter(configs[Cycles], -1);
+    if (m_fds[Cycles] == -1) {
+        m_error = QString("perf_event_open: %1").arg(strerror(errno));
+        if (errno == EACCES || errno == EPERM) {
+            m_error += " (see /proc/sys/kernel/perf_event_paranoid)";
+        }
+    }
+
+    // The rest of the counters are optional, e.g. virtual machines
+    // often don't expose cache misses.
+    for (int i = Cycles + 1; i < NumCounters; i++) {
+        m_fds[i] =
+            m_fds[Cycles] == -1 ? -1 : openCounter(configs[i], m_fds[Cycles]);
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : m_fds) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+}
+
+bool PerfCounters::available() const { return m_fds[Cycles] != -1; }
+
+QString PerfCounters::errorString() const { return m_error; }
+
+void PerfCounters::start() {
+    if (!available()) {
+        return;
+    }
+    ioctl(m_fds[Cycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(m_fds[Cycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounts PerfCounters::stop() {
+    PerfCounts counts;
+    if (!available()) {
+        return counts;
+    }
+
+    ioctl(m_fds[Cycles], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    struct {
+        std::uint64_t nr;
+        std::uint64_t timeEnabled;
+        std::uint64_t timeRunning;
+        struct {
+            std::uint64_t value;
+            std::uint64_t id;
+        } values[NumCounters];
+    } data;
+
+    if (read(m_fds[Cycles], &data, sizeof(data)) == -1) {
+        return counts;
+    }
+
+    std::uint64_t ids[NumCounters];
+    for (int i = 0; i < NumCounters; i++) {
+        if (m_fds[i] == -1 || ioctl(m_fds[i], PERF_EVENT_IOC_ID, &ids[i])) {
+            ids[i] = ~0ull;
+        }
+    }
+
+    // Scale up if the group was multiplexed with other events.
+    const double scale =
+        data.timeRunning ? double(data.timeEnabled) / data.timeRunning : 1.0;
+
+    std::optional<std::uint64_t> *fields[NumCounters] = {
+        &counts.cycles,
+        &counts.instructions,
+        &counts.branchMisses,
+        &counts.cacheMisses,
+    };
+    for (std::uint64_t v = 0; v < data.nr && v < NumCounters; v++) {
+        for (int i = 0; i < NumCounters; i++) {
+            if (data.values[v].id == ids[i]) {
+                *fields[i] = data.values[v].value * scale;
+            }
+        }
+    }
+
+    return counts;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    for (int &fd : m_fds) {
+        fd = -1;
+    }
+    m_error = "Performance counters are only supported on Linux";
+}
+
+PerfCounters::~PerfCounters() {}
+
+bool PerfCounters::available() const { return false; }
+
+QString PerfCounters::errorString() const { return m_error; }
+
+void PerfCounters::start() {}
+
+PerfCounts PerfCounters::stop() { return {}; }
+
+#endif
@@ -0,0 +1,43 @@
+/* -*- mode: c++; -*- */
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <QString>
+#include <cstdint>
+#include <optional>
+
+struct PerfCounts {
+    // Unset when the counter couldn't be opened.
+    std::optional<std::uint64_t> cycles;
+    std::optional<std::uint64_t> instructions;
+    std::optional<std::uint64_t> branchMisses;
+    std::optional<std::uint64_t> cacheMisses;
+};
+
+// A group of hardware performance counters (perf_event_open) counting
+// user-space events of the thread that created it.  Threads spawned
+// by that thread are not counted.
+class PerfCounters {
+  public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // False if the kernel doesn't allow access to the counters, in
+    // which case errorString() says why.
+    bool available() const;
+    QString errorString() const;
+
+    void start();
+    PerfCounts stop();
+
+  private:
+    enum { Cycles, Instructions, BranchMisses, CacheMisses, NumCounters };
+
+    int m_fds[NumCounters];
+    QString m_error;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "Plugins.h"
+#include "Algorithms.h"
+#include "SortPlugin.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QLibrary>
+
+static int comparePluginItems(void *context, size_t i, size_t j) {
+    auto &vec = *static_cast<std::vector<SortItem> *>(context);
+    const auto order = vec[i] <=> vec[j];
+    return order < 0 ? -1 : order > 0 ? 1 : 0;
+}
+
+static void swapPluginItems(void *context, size_t i, size_t j) {
+    auto &vec = *static_cast<std::vector<SortItem> *>(context);
+    std::swap(vec[i], vec[j]);
+}
+
+static int getPluginItem(void *context, size_t i) {
+    auto &vec = *static_cast<std::vector<SortItem> *>(context);
+    return vec[i].value();
+}
+
+static void setPluginItem(void *context, size_t i, int value) {
+    auto &vec = *static_cast<std::vector<SortItem> *>(context);
+    vec[i] = SortItem(value);
+}
+
+static AuxMemory pluginAuxMemory(int aux) {
+    switch (aux) {
+    case SORT_PLUGIN_AUX_CONSTANT:
+        return AuxMemory::Constant;
+    case SORT_PLUGIN_AUX_LOGARITHMIC:
+        return AuxMemory::Logarithmic;
+    case SORT_PLUGIN_AUX_SQRT:
+        return AuxMemory::SquareRoot;
+    }
+    return AuxMemory::Linear;
+}
+
+static Algorithm pluginAlgorithm(const sort_plugin_algorithm &desc) {
+    Algorithm algorithm{
+        .name = QString::fromUtf8(desc.name),
+        .function =
+            [sort = desc.sort](std::vector<SortItem> &vec) {
+                const sort_plugin_array array = {
+                    .context = &vec,
+                    .size = vec.size(),
+                    .compare = comparePluginItems,
+                    .swap = swapPluginItems,
+                    .get = getPluginItem,
+                    .set = setPluginItem,
+                };
+                sort(&array);
+            },
+        .stable = bool(desc.flags & SORT_PLUGIN_STABLE),
+        .inPlace = bool(desc.flags & SORT_PLUGIN_IN_PLACE),
+        .auxMemory = pluginAuxMemory(desc.aux_memory),
+        .parallel = bool(desc.flags & SORT_PLUGIN_PARALLEL),
+        .minRecommendedSize = desc.min_size,
+    };
+
+    if (desc.max_size != 0) {
+        algorithm.maxRecommendedSize = desc.max_size;
+    }
+    if (auto *sort = desc.sort_int32) {
+        algorithm.sortInt32 = [sort](std::span<std::int32_t> keys) {
+            sort(keys.data(), keys.size());
+        };
+    }
+    if (auto *sort = desc.sort_int64) {
+        algorithm.sortInt64 = [sort](std::span<std::int64_t> keys) {
+            sort(keys.data(), keys.size());
+        };
+    }
+    if (auto *sort = desc.sort_float) {
+        algorithm.sortFloat = [sort](std::span<float> keys) {
+            sort(keys.data(), keys.size());
+        };
+    }
+
+    return algorithm;
+}
+
+static int loadPlugin(const QString &path) {
+    // Never unloaded: the registered algorithms point into the library.
+    QLibrary library(path);
+    if (!library.load()) {
+        fprintf(stderr, "Failed to load plugin %s: %s\n", qPrintable(path),
+                qPrintable(library.errorString()));
+        return 0;
+    }
+
+    auto entryPoint = reinterpret_cast<sort_plugin_entry_point>(
+        library.resolve(SORT_PLUGIN_ENTRY_POINT));
+    if (!entryPoint) {
+        fprintf(stderr, "Plugin %s doesn't export %s\n", qPrintable(path),
+                SORT_PLUGIN_ENTRY_POINT);
+        return 0;
+    }
+
+    size_t count = 0;
+    const sort_plugin_algorithm *descs =
+        entryPoint(SORT_PLUGIN_ABI_VERSION, &count);
+    if (!descs) {
+        fprintf(stderr, "Plugin %s doesn't support ABI version %d\n",
+                qPrintable(path), SORT_PLUGIN_ABI_VERSION);
+        return 0;
+    }
+
+    int registered = 0;
+    for (size_t i = 0; i < count; i++) {
+        const auto &desc = descs[i];
+        if (!desc.name || !desc.sort) {
+            fprintf(stderr, "Plugin %s: skipping incomplete algorithm #%zu\n",
+                    qPrintable(path), i);
+            continue;
+        }
+        RegisterAlgorithm(pluginAlgorithm(desc));
+        registered++;
+    }
+
+    return registered;
+}
+
+QString defaultPluginDirectory() {
+    if (qEnvironmentVariableIsSet("SORT_PLUGIN_PATH")) {
+        return qEnvironmentVariable("SORT_PLUGIN_PATH");
+    }
+    return QDir(QCoreApplication::applicationDirPath()).filePath("plugins");
+}
+
+int LoadPlugins(const QString &directory) {
+    QDir dir(directory);
+    if (!dir.exists()) {
+        return 0;
+    }
+
+    int registered = 0;
+    for (const auto &entry : dir.entryInfoList(QDir::Files, QDir::Name)) {
+        if (QLibrary::isLibrary(entry.fileName())) {
+            registered += loadPlugin(entry.absoluteFilePath());
+        }
+    }
+
+    return registered;
+}
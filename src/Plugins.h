@@ -0,0 +1,15 @@
+/* -*- mode: c++; -*- */
+#ifndef PLUGINS_H
+#define PLUGINS_H
+
+#include <QString>
+
+// Directory searched when no directory is given on the command line:
+// $SORT_PLUGIN_PATH if set, otherwise "plugins" next to the executable.
+QString defaultPluginDirectory();
+
+// Loads every plugin in a directory and registers its algorithms.
+// Returns the number of algorithms registered.
+int LoadPlugins(const QString &directory);
+
+#endif
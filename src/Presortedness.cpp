@@ -0,0 +1,118 @@
+#include "Presortedness.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+double Presortedness::runsRatio() const {
+    return size > 1 ? double(runs - 1) / (size - 1) : 0;
+}
+
+double Presortedness::inversionRatio() const {
+    return size > 1 ? inversions / (size * (size - 1) / 2.0) : 0;
+}
+
+double Presortedness::displacementRatio() const {
+    return size > 1 ? double(maxDisplacement) / (size - 1) : 0;
+}
+
+Presortedness analyzePresortedness(std::span<const int> values) {
+    const auto size = values.size();
+    Presortedness result{.size = size};
+    if (values.empty()) {
+        return result;
+    }
+
+    result.runs = 1;
+    for (std::size_t i = 1; i < size; i++) {
+        if (values[i] < values[i - 1]) {
+            result.runs++;
+        }
+    }
+
+    // Values with their indices, merge sorted bottom-up, counting the
+    // values each value from the right half jumps over.
+    std::vector<std::pair<int, std::size_t>> items(size), buffer(size);
+    for (std::size_t i = 0; i < size; i++) {
+        items[i] = {values[i], i};
+    }
+    for (std::size_t width = 1; width < size; width *= 2) {
+        for (std::size_t begin = 0; begin < size; begin += 2 * width) {
+            const auto middle = std::min(begin + width, size);
+            const auto end = std::min(begin + 2 * width, size);
+            auto left = begin, right = middle, out = begin;
+            while (left < middle && right < end) {
+                if (items[right].first < items[left].first) {
+                    result.inversions += middle - left;
+                    buffer[out++] = items[right++];
+                } else {
+                    buffer[out++] = items[left++];
+                }
+            }
+            std::copy(items.begin() + left, items.begin() + middle,
+                      buffer.begin() + out);
+            std::copy(items.begin() + right, items.begin() + end,
+                      buffer.begin() + out + (middle - left));
+        }
+        std::swap(items, buffer);
+    }
+
+    std::size_t duplicates = 0;
+    for (std::size_t i = 0; i < size; i++) {
+        const auto index = items[i].second;
+        result.maxDisplacement =
+            std::max(result.maxDisplacement, i > index ? i - index : index - i);
+        if (i > 0 && items[i - 1].first == items[i].first) {
+            duplicates++;
+        }
+    }
+    result.duplicateRatio = double(duplicates) / size;
+
+    return result;
+}
+
+Presortedness estimatePresortedness(std::span<const int> sample,
+                                    std::size_t blockSize, std::size_t size) {
+    const auto measured = analyzePresortedness(sample);
+    if (sample.size() >= size) {
+        return measured;
+    }
+
+    // Only neighbours within a block are neighbours in the sequence.
+    std::size_t pairs = 0, descents = 0;
+    for (std::size_t begin = 0; begin < sample.size(); begin += blockSize) {
+        const auto end = std::min(begin + blockSize, sample.size());
+        for (auto i = begin + 1; i < end; i++) {
+            pairs++;
+            descents += sample[i] < sample[i - 1];
+        }
+    }
+
+    // The fraction of equal pairs in the sample estimates how many
+    // copies of its value an average value has in the whole sequence.
+    // With c copies of each distinct value, 1 - distinct / size is
+    // 1 - 1 / c.
+    std::vector<int> sorted(sample.begin(), sample.end());
+    std::sort(sorted.begin(), sorted.end());
+    double equalPairs = 0;
+    for (auto begin = sorted.begin(); begin != sorted.end();) {
+        const auto end = std::upper_bound(begin, sorted.end(), *begin);
+        equalPairs += double(end - begin) * (end - begin - 1) / 2;
+        begin = end;
+    }
+    const double samplePairs = sorted.size() * (sorted.size() - 1) / 2.0;
+    const double copies =
+        1 + (samplePairs ? equalPairs / samplePairs * (size - 1) : 0);
+
+    Presortedness result = measured;
+    result.duplicateRatio = 1 - 1 / copies;
+    result.size = size;
+    result.runs = 1 + (pairs ? std::llround(double(descents) / pairs *
+                                            (size - 1))
+                             : 0);
+    result.inversions = std::llround(measured.inversionRatio() * size *
+                                     (size - 1) / 2.0);
+    result.maxDisplacement =
+        std::llround(measured.displacementRatio() * (size - 1));
+    return result;
+}
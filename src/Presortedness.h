@@ -0,0 +1,36 @@
+/* -*- mode: c++; -*- */
+#ifndef PRESORTEDNESS_H
+#define PRESORTEDNESS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Measures of how far a sequence of values is from sorted.
+struct Presortedness {
+    std::size_t size = 0;
+    // Maximal non-descending runs, 1 if sorted.
+    std::size_t runs = 0;
+    // Pairs of values out of order.
+    std::uint64_t inversions = 0;
+    // Largest distance of a value from its index after a stable sort.
+    std::size_t maxDisplacement = 0;
+    // Fraction of values equal to an earlier one, 1 - distinct / size.
+    double duplicateRatio = 0;
+
+    // The measures relative to their maxima, in [0, 1].
+    double runsRatio() const;
+    double inversionRatio() const;
+    double displacementRatio() const;
+};
+
+// Measures all values, in O(n log n) time and O(n) memory.
+Presortedness analyzePresortedness(std::span<const int> values);
+
+// Estimates the measures of a sequence of size values from a sample of
+// blocks of consecutive values taken at even intervals, in the order
+// they appear in.
+Presortedness estimatePresortedness(std::span<const int> sample,
+                                    std::size_t blockSize, std::size_t size);
+
+#endif
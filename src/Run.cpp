@@ -1,8 +1,7 @@
 #include "Run.h"
+#include "Affinity.h"
 #include "SortItem.h"
-#include <qscopeguard.h>
-
-static constexpr int FPS = 25;
+#include <QDeadlineTimer>
 
 class Interrupt : public std::exception {};
 
@@ -11,57 +10,349 @@ class Run::Callbacks : public SortItemCallbacks {
     Callbacks(Run &run) : m_run(run) {}
 
     void onComparison(const SortItem &lhs, const SortItem &rhs) override {
+        AllocationTracker::Suspend suspend;
         QMutexLocker<QMutex> lock(&m_run.shared.mutex);
+        checkBreakpoint(Breakpoint::Operation::Comparison, {&lhs, &rhs});
         commonCallback(lock);
 
-        if (lhs.graphicsItem()) {
-            m_run.shared.sceneChanges.addAccess(lhs.mutableGraphicsItem());
-        }
-        if (rhs.graphicsItem()) {
-            m_run.shared.sceneChanges.addAccess(rhs.mutableGraphicsItem());
-        }
-        m_run.shared.stats.comparisons++;
-        m_run.shared.stats.accesses += 2;
+        addAccess(lhs, simulateAccess(lhs));
+        addAccess(rhs, simulateAccess(rhs));
+        lock.unlock();
+
+        auto &counters = m_run.countersForCurrentThread();
+        increment(counters.comparisons);
+        countRead(counters, lhs);
+        countRead(counters, rhs);
+    }
+
+    void onSwap(const SortItem &, const SortItem &) override {
+        AllocationTracker::Suspend suspend;
+        increment(m_run.countersForCurrentThread().swaps);
     }
 
     void onAccess(const SortItem &item) override {
+        AllocationTracker::Suspend suspend;
         QMutexLocker<QMutex> lock(&m_run.shared.mutex);
         commonCallback(lock);
 
-        if (item.graphicsItem()) {
-            m_run.shared.sceneChanges.addAccess(item.mutableGraphicsItem());
-        }
+        addAccess(item, simulateAccess(item));
+        lock.unlock();
 
-        m_run.shared.stats.accesses++;
+        countRead(m_run.countersForCurrentThread(), item);
     }
 
     void onAssignment(const SortItem &item, int /*oldValue*/, int newValue,
-                      const SortItem * /*from*/ = nullptr) override {
+                      const SortItem &from, ItemTransfer transfer) override {
+        AllocationTracker::Suspend suspend;
         QMutexLocker<QMutex> lock(&m_run.shared.mutex);
+        checkBreakpoint(Breakpoint::Operation::Assignment, {&item});
         commonCallback(lock);
 
-        if (item.graphicsItem()) {
-            m_run.shared.sceneChanges.addAssignment(item.mutableGraphicsItem(),
-                                                    newValue);
-            m_run.shared.stats.accesses++;
+        simulateAccess(from);
+        addAssignment(item, newValue, simulateAccess(item));
+        lock.unlock();
+
+        auto &counters = m_run.countersForCurrentThread();
+        countRead(counters, from);
+        countWrite(counters, item);
+        countTransfer(counters, transfer);
+    }
+
+    // Only counted: new items aren't drawn, and temporaries are too
+    // frequent to pause or delay for.
+    void onConstruction(const SortItem &item, const SortItem &from,
+                        ItemTransfer transfer) override {
+        AllocationTracker::Suspend suspend;
+        auto &counters = m_run.countersForCurrentThread();
+        countRead(counters, from);
+        countWrite(counters, item);
+        countTransfer(counters, transfer);
+    }
+
+    // Block operations are one step and one delay, and their items
+    // are drawn as changed in the same frame.
+    void onRangeCopy(std::span<const SortItem> to,
+                     std::span<const SortItem> from,
+                     ItemTransfer transfer) override {
+        AllocationTracker::Suspend suspend;
+        QMutexLocker<QMutex> lock(&m_run.shared.mutex);
+        checkBreakpoint(Breakpoint::Operation::Assignment, to);
+        commonCallback(lock);
+
+        for (std::size_t i = 0; i < to.size(); i++) {
+            simulateAccess(from[i]);
+            addAssignment(to[i], valueOf(from[i]), simulateAccess(to[i]));
+        }
+        lock.unlock();
+
+        countBlock(to, from, transfer);
+    }
+
+    void onRotate(std::span<const SortItem> items,
+                  std::size_t middle) override {
+        AllocationTracker::Suspend suspend;
+        QMutexLocker<QMutex> lock(&m_run.shared.mutex);
+        checkBreakpoint(Breakpoint::Operation::Assignment, items);
+        commonCallback(lock);
+
+        // Nothing moved yet.
+        for (std::size_t i = 0; i < items.size(); i++) {
+            const auto &from = items[(i + middle) % items.size()];
+            addAssignment(items[i], valueOf(from), simulateAccess(items[i]));
+        }
+        lock.unlock();
+
+        countBlock(items, items, ItemTransfer::Move);
+    }
+
+    void onSwapRanges(std::span<const SortItem> a,
+                      std::span<const SortItem> b) override {
+        AllocationTracker::Suspend suspend;
+        QMutexLocker<QMutex> lock(&m_run.shared.mutex);
+        checkBreakpoint(Breakpoint::Operation::Assignment, a);
+        checkBreakpoint(Breakpoint::Operation::Assignment, b);
+        commonCallback(lock);
+
+        for (std::size_t i = 0; i < a.size(); i++) {
+            addAssignment(a[i], valueOf(b[i]), simulateAccess(a[i]));
+            addAssignment(b[i], valueOf(a[i]), simulateAccess(b[i]));
+        }
+        lock.unlock();
+
+        auto &counters = m_run.countersForCurrentThread();
+        add(counters.swaps, a.size());
+        countBlock(a, b, ItemTransfer::Swap);
+        countBlock(b, a, ItemTransfer::Swap);
+    }
+
+    void onBufferCreated(std::span<const SortItem> items) override {
+        if (items.empty()) {
+            return;
+        }
+        AllocationTracker::Suspend suspend;
+        QMutexLocker<QMutex> lock(&m_run.shared.mutex);
+        const int lane = m_run.shared.nextLane++;
+        m_run.shared.lanes[items.data()] = {lane, items.size()};
+        m_run.shared.sceneChanges.addLane(lane, items.size());
+    }
+
+    void onBufferDestroyed(std::span<const SortItem> items) override {
+        if (items.empty()) {
+            return;
+        }
+        AllocationTracker::Suspend suspend;
+        QMutexLocker<QMutex> lock(&m_run.shared.mutex);
+        auto it = m_run.shared.lanes.find(items.data());
+        if (it != m_run.shared.lanes.end()) {
+            m_run.shared.sceneChanges.removeLane(it->second.first);
+            m_run.shared.lanes.erase(it);
         }
     }
 
   private:
-    void commonCallback(QMutexLocker<QMutex> &lock) {
-        // Assumes lock is held
-        while (m_run.shared.pauseRequested && !m_run.shared.stopRequested) {
-            lock.unlock();
-            QScopeGuard guard([&] { lock.relock(); });
-            QThread::usleep(10000);
+    // Assumes lock is held.
+    std::optional<SceneChanges::LaneItem>
+    findLaneItem(const SortItem &item) const {
+        const auto &lanes = m_run.shared.lanes;
+        auto it = lanes.upper_bound(&item);
+        if (it == lanes.begin()) {
+            return std::nullopt;
         }
-        if (m_run.shared.stopRequested) {
-            throw Interrupt();
+        --it;
+        const auto &[lane, size] = it->second;
+        if (&item >= it->first + size) {
+            return std::nullopt;
         }
+        return SceneChanges::LaneItem(lane, &item - it->first);
+    }
 
-        lock.unlock();
-        QScopeGuard guard([&] { lock.relock(); });
-        QThread::usleep(m_run.shared.delay.count());
+    // Assumes lock is held.
+    void addAssignment(const SortItem &item, int value, int cacheLevel) {
+        auto &changes = m_run.shared.sceneChanges;
+        if (item.graphicsItem()) {
+            changes.addAssignment(item.mutableGraphicsItem(), value,
+                                  cacheLevel);
+        } else if (auto laneItem = findLaneItem(item)) {
+            changes.addLaneAssignment(*laneItem, value, cacheLevel);
+        }
+    }
+
+    // Assumes lock is held.
+    void addAccess(const SortItem &item, int cacheLevel) {
+        auto &changes = m_run.shared.sceneChanges;
+        if (item.graphicsItem()) {
+            changes.addAccess(item.mutableGraphicsItem(), cacheLevel);
+        } else if (auto laneItem = findLaneItem(item)) {
+            changes.addLaneAccess(*laneItem, cacheLevel);
+        }
+    }
+
+    static void add(std::atomic<std::uint64_t> &counter, std::uint64_t n) {
+        // Single writer, see ThreadCounters.
+        constexpr auto relaxed = std::memory_order_relaxed;
+        counter.store(counter.load(relaxed) + n, relaxed);
+    }
+
+    static void increment(std::atomic<std::uint64_t> &counter) {
+        add(counter, 1);
+    }
+
+    std::optional<std::size_t> indexInVector(const SortItem &item) const {
+        const auto &vec = m_run.m_vector;
+        if (&item < vec.data() || &item >= vec.data() + vec.size()) {
+            return std::nullopt;
+        }
+        return &item - vec.data();
+    }
+
+    void countRead(ThreadCounters &counters, const SortItem &item) {
+        increment(counters.reads);
+        if (auto index = indexInVector(item)) {
+            m_run.m_heatmap.addRead(*index);
+        } else {
+            increment(counters.auxAccesses);
+        }
+    }
+
+    void countWrite(ThreadCounters &counters, const SortItem &item) {
+        increment(counters.writes);
+        if (auto index = indexInVector(item)) {
+            m_run.m_heatmap.addWrite(*index);
+        } else {
+            increment(counters.auxAccesses);
+        }
+    }
+
+    void countTransfer(ThreadCounters &counters, ItemTransfer transfer,
+                       std::uint64_t n = 1) {
+        switch (transfer) {
+        case ItemTransfer::Copy:
+            add(counters.copies, n);
+            break;
+        case ItemTransfer::Move:
+            add(counters.moves, n);
+            break;
+        case ItemTransfer::Swap:
+            // Counted by onSwap().
+            break;
+        }
+    }
+
+    // Counts writes of the items of to from those of from, as if each
+    // was assigned.
+    void countBlock(std::span<const SortItem> to,
+                    std::span<const SortItem> from, ItemTransfer transfer) {
+        auto &counters = m_run.countersForCurrentThread();
+        add(counters.reads, from.size());
+        add(counters.writes, to.size());
+        countTransfer(counters, transfer, to.size());
+        std::uint64_t auxAccesses = 0;
+        for (const auto &item : from) {
+            if (auto index = indexInVector(item)) {
+                m_run.m_heatmap.addRead(*index);
+            } else {
+                auxAccesses++;
+            }
+        }
+        for (const auto &item : to) {
+            if (auto index = indexInVector(item)) {
+                m_run.m_heatmap.addWrite(*index);
+            } else {
+                auxAccesses++;
+            }
+        }
+        add(counters.auxAccesses, auxAccesses);
+    }
+
+    // Assumes lock is held.  Returns the cache level which served the
+    // access, as expected by SceneChanges.
+    int simulateAccess(const SortItem &item) {
+        auto &cache = m_run.shared.cache;
+        if (!cache) {
+            return SceneChanges::NotSimulated;
+        }
+        const int level =
+            cache->access(reinterpret_cast<std::uintptr_t>(&item));
+        return level == cache->levels().size() ? SceneChanges::MemoryAccess
+                                               : level;
+    }
+
+    // Assumes lock is held.  Pauses the run before the operation of
+    // the breakpoint.
+    void checkBreakpoint(Breakpoint::Operation operation,
+                         std::initializer_list<const SortItem *> items) {
+        for (const auto *item : items) {
+            if (checkBreakpoint(operation, *item)) {
+                return;
+            }
+        }
+    }
+
+    void checkBreakpoint(Breakpoint::Operation operation,
+                         std::span<const SortItem> items) {
+        // Blocks are large, and breakpoints rare.
+        const auto &breakpoint = m_run.shared.breakpoint;
+        if (!breakpoint || breakpoint->operation != operation) {
+            return;
+        }
+        for (const auto &item : items) {
+            if (checkBreakpoint(operation, item)) {
+                return;
+            }
+        }
+    }
+
+    bool checkBreakpoint(Breakpoint::Operation operation,
+                         const SortItem &item) {
+        auto &shared = m_run.shared;
+        if (!shared.breakpoint || shared.breakpoint->operation != operation ||
+            indexInVector(item) != shared.breakpoint->index) {
+            return false;
+        }
+        shared.breakpoint.reset();
+        shared.pauseRequested = true;
+        shared.steps = 0;
+        emit m_run.workerPaused();
+        return true;
+    }
+
+    void commonCallback(QMutexLocker<QMutex> &) {
+        // Assumes lock is held
+        auto &shared = m_run.shared;
+        for (;;) {
+            while (shared.pauseRequested && !shared.steps &&
+                   !shared.stopRequested) {
+                shared.wakeUp.wait(&shared.mutex);
+            }
+            if (shared.stopRequested) {
+                throw Interrupt();
+            }
+            if (shared.pauseRequested) {
+                // Steps aren't delayed.
+                if (--shared.steps == 0) {
+                    emit m_run.workerPaused();
+                }
+                return;
+            }
+            if (shared.delay.count() == 0) {
+                return;
+            }
+
+            // Waits out the delay on the condition rather than sleeps,
+            // so that stopping or pausing doesn't wait for all of it.
+            const QDeadlineTimer deadline(shared.delay, Qt::PreciseTimer);
+            while (!shared.stopRequested && !shared.pauseRequested &&
+                   shared.wakeUp.wait(&shared.mutex, deadline)) {
+            }
+            if (shared.stopRequested) {
+                throw Interrupt();
+            }
+            // Paused during the delay: parks before the operation, as
+            // if paused before it.
+            if (!shared.pauseRequested) {
+                return;
+            }
+        }
     }
 
     Run &m_run;
@@ -73,11 +364,18 @@ Run::WorkerThread::WorkerThread(const std::function<void()> &func,
 
 void Run::WorkerThread::run() { m_func(); }
 
+static std::atomic<std::uint64_t> nextRunId = 1;
+
 Run::Run(std::vector<SortItem> &vec, std::chrono::microseconds delay,
          QObject *parent)
-    : QObject(parent), m_vector(vec), m_state(State::NotStarted), m_timer(-1),
-      m_callbacks(nullptr), m_thread(nullptr),
-      shared{{}, false, false, delay, {static_cast<int>(vec.size())}, Stats{}} {
+    : QObject(parent), m_vector(vec), m_state(State::NotStarted),
+      m_pacer(new FramePacer(this)), m_callbacks(nullptr), m_thread(nullptr),
+      m_heatmap(vec.size()), m_id(nextRunId++),
+      shared{{}, {}, false, false, 0, std::nullopt, delay,
+             {static_cast<int>(vec.size())}, std::nullopt, {}, 0} {
+    connect(m_pacer, SIGNAL(frameRequested()), this, SLOT(onFrameRequested()));
+    connect(this, SIGNAL(workerPaused()), this, SLOT(onWorkerPaused()),
+            Qt::QueuedConnection);
 }
 
 Run::~Run() {
@@ -94,25 +392,47 @@ Run::~Run() {
 
 Run::State Run::state() const { return m_state; }
 
-bool Run::start(const Algorithm &algorithm) {
+void Run::setSelectionK(std::size_t k) { m_selectionK = k; }
+
+void Run::setCacheLevels(const QVector<CacheLevelConfig> &levels) {
+    QMutexLocker<QMutex> lock(&shared.mutex);
+    if (levels.empty()) {
+        shared.cache.reset();
+    } else {
+        shared.cache.emplace(levels);
+    }
+}
+
+bool Run::start(const Algorithm &algorithm, bool paused) {
     if (m_state != State::NotStarted) {
         return false;
     }
 
-    m_state = State::Running;
+    {
+        QMutexLocker<QMutex> lock(&shared.mutex);
+        shared.pauseRequested = paused;
+    }
+
+    m_state = paused ? State::Paused : State::Running;
     emit stateChanged(m_state);
 
-    m_timer = startTimer(1000 / FPS);
+    if (!paused) {
+        m_pacer->start();
+    }
+    m_rateTimer.start();
 
     m_callbacks = new Callbacks(*this);
 
-    auto func = algorithm.function;
-
     m_thread = new WorkerThread(
-        [this, func] {
+        [this, algorithm, k = m_selectionK] {
+            if (const auto error = applyToCurrentThread(threadPlacement());
+                !error.isEmpty()) {
+                fprintf(stderr, "%s\n", qPrintable(error));
+            }
             SortItem::setCallbacksForCurrentThread(m_callbacks);
+            AllocationTracker::Scope allocationScope(m_allocations);
             try {
-                func(m_vector);
+                algorithm.run(m_vector, k);
             } catch (Interrupt &) {
             }
         },
@@ -133,6 +453,7 @@ bool Run::stop() {
     {
         QMutexLocker<QMutex> lock(&shared.mutex);
         shared.stopRequested = true;
+        shared.wakeUp.wakeAll();
     }
 
     m_thread->wait();
@@ -145,11 +466,7 @@ bool Run::stop() {
     m_state = State::Finished;
     emit stateChanged(m_state);
 
-    if (m_timer != -1) {
-        // Running state.
-        killTimer(m_timer);
-        m_timer = -1;
-    }
+    m_pacer->stop();
 
     return true;
 }
@@ -162,13 +479,13 @@ bool Run::pause() {
     {
         QMutexLocker<QMutex> lock(&shared.mutex);
         shared.pauseRequested = true;
+        shared.wakeUp.wakeAll();
     }
 
     m_state = State::Paused;
     emit stateChanged(m_state);
 
-    killTimer(m_timer);
-    m_timer = -1;
+    m_pacer->stop();
 
     return true;
 }
@@ -181,12 +498,42 @@ bool Run::resume() {
     {
         QMutexLocker<QMutex> lock(&shared.mutex);
         shared.pauseRequested = false;
+        shared.steps = 0;
+        shared.wakeUp.wakeAll();
     }
 
     m_state = State::Running;
     emit stateChanged(m_state);
 
-    m_timer = startTimer(1000 / FPS);
+    m_pacer->start();
+    // Don't count the pause in the rate.
+    m_rateTimer.restart();
+
+    return true;
+}
+
+bool Run::step(std::uint64_t ops) {
+    if (m_state != State::Paused || ops == 0) {
+        return false;
+    }
+
+    QMutexLocker<QMutex> lock(&shared.mutex);
+    shared.steps += ops;
+    shared.wakeUp.wakeAll();
+
+    return true;
+}
+
+bool Run::runUntil(Breakpoint breakpoint) {
+    if (m_state != State::Running && m_state != State::Paused) {
+        return false;
+    }
+
+    {
+        QMutexLocker<QMutex> lock(&shared.mutex);
+        shared.breakpoint = breakpoint;
+    }
+    resume();
 
     return true;
 }
@@ -196,7 +543,56 @@ void Run::setDelay(std::chrono::microseconds delay) {
     shared.delay = delay;
 }
 
-void Run::timerEvent(QTimerEvent *) { maybeDrainChanges(); }
+Run::ThreadCounters &Run::countersForCurrentThread() {
+    static thread_local struct {
+        std::uint64_t runId = 0;
+        ThreadCounters *counters = nullptr;
+    } cached;
+
+    if (cached.runId != m_id) {
+        QMutexLocker<QMutex> lock(&m_countersMutex);
+        m_threadCounters.push_back(std::make_unique<ThreadCounters>());
+        cached.runId = m_id;
+        cached.counters = m_threadCounters.back().get();
+    }
+    return *cached.counters;
+}
+
+void Run::addCounts(Stats &stats) const {
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    QMutexLocker<QMutex> lock(&m_countersMutex);
+    for (const auto &counters : m_threadCounters) {
+        stats.reads += counters->reads.load(relaxed);
+        stats.writes += counters->writes.load(relaxed);
+        stats.swaps += counters->swaps.load(relaxed);
+        stats.copies += counters->copies.load(relaxed);
+        stats.moves += counters->moves.load(relaxed);
+        stats.comparisons += counters->comparisons.load(relaxed);
+        stats.auxAccesses += counters->auxAccesses.load(relaxed);
+    }
+}
+
+FramePacer *Run::framePacer() const { return m_pacer; }
+
+void Run::onFrameRequested() { maybeDrainChanges(); }
+
+void Run::onWorkerPaused() {
+    {
+        QMutexLocker<QMutex> lock(&shared.mutex);
+        // Resumed or stopped since.
+        if (!shared.pauseRequested || shared.stopRequested) {
+            return;
+        }
+    }
+
+    if (m_state == State::Running) {
+        m_state = State::Paused;
+        emit stateChanged(m_state);
+        m_pacer->stop();
+    }
+    maybeDrainChanges();
+}
 
 void Run::maybeDrainChanges(bool force) {
     std::optional<SceneChanges> changes;
@@ -204,7 +600,10 @@ void Run::maybeDrainChanges(bool force) {
 
     {
         QMutexLocker<QMutex> lock(&shared.mutex);
-        stats = shared.stats;
+        stats.memory = m_allocations.stats();
+        if (shared.cache) {
+            stats.cache = shared.cache->stats();
+        }
         if (!shared.sceneChanges.empty() || force) {
             auto size = shared.sceneChanges.numItemsInVector();
             changes = std::move(shared.sceneChanges);
@@ -212,8 +611,29 @@ void Run::maybeDrainChanges(bool force) {
         }
     }
 
+    addCounts(stats);
+    if (m_rateTimer.isValid()) {
+        const auto nsecs = m_rateTimer.nsecsElapsed();
+        if (nsecs > 0) {
+            stats.accessesPerSecond =
+                (stats.accesses() - m_lastAccesses) * 1e9 / nsecs;
+        }
+        m_rateTimer.restart();
+        m_lastAccesses = stats.accesses();
+    }
+
+    QElapsedTimer applyTimer;
+    applyTimer.start();
+    bool repaintExpected = false;
     if (changes) {
         emit sceneChangesReady(*changes);
+        repaintExpected = true;
+    }
+    if (stats.accesses() != m_heatmapAccesses || force) {
+        m_heatmapAccesses = stats.accesses();
+        emit heatmapReady(m_heatmap.render());
+        repaintExpected = true;
     }
+    m_pacer->frameApplied(repaintExpected, applyTimer.nsecsElapsed());
     emit statsReady(stats);
 }
@@ -3,20 +3,47 @@
 #define RUN_H
 
 #include "Algorithms.h"
+#include "Allocation.h"
+#include "CacheSim.h"
+#include "FramePacer.h"
 #include "Graphics.h"
+#include "Heatmap.h"
 #include "SortItem.h"
 
+#include <QElapsedTimer>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QObject>
 #include <QThread>
+#include <QWaitCondition>
+#include <atomic>
+#include <map>
+#include <memory>
 
 class Run : public QObject {
     Q_OBJECT
   public:
     struct Stats {
-        int accesses = 0;
-        int comparisons = 0;
+        std::uint64_t reads = 0;
+        std::uint64_t writes = 0;
+        std::uint64_t swaps = 0;
+        // Writes which copied or moved another item, into an existing
+        // item or a new one.  Every write is a copy, a move or half of
+        // a swap.
+        std::uint64_t copies = 0;
+        std::uint64_t moves = 0;
+        std::uint64_t comparisons = 0;
+        // Reads and writes of items outside of the vector being
+        // sorted, e.g. in temporary buffers.  Also counted in reads
+        // and writes.
+        std::uint64_t auxAccesses = 0;
+        // Reads and writes per second since the previous stats.
+        double accessesPerSecond = 0;
+        AllocationStats memory;
+        // Empty unless cache simulation is enabled.
+        QVector<CacheLevelStats> cache;
+
+        std::uint64_t accesses() const { return reads + writes; }
     };
 
     Run(std::vector<SortItem> &vec, std::chrono::microseconds delay,
@@ -34,20 +61,56 @@ class Run : public QObject {
 
     State state() const;
 
+    // An operation on an item of the vector, before which runUntil()
+    // pauses the run.
+    struct Breakpoint {
+        enum class Operation {
+            Comparison,
+            Assignment,
+        };
+        Operation operation = Operation::Assignment;
+        std::size_t index = 0;
+    };
+
+    // Runs a running or paused run until the next operation of the
+    // breakpoint, and pauses it before that operation.
+    bool runUntil(Breakpoint);
+
+    // Feeds every access into a simulated cache hierarchy, if levels
+    // is not empty.  Must be called before start().
+    void setCacheLevels(const QVector<CacheLevelConfig> &levels);
+    // k of selection algorithms.  Must be called before start().
+    void setSelectionK(std::size_t k);
+
   public slots:
-    bool start(const Algorithm &);
+    // Starts the run, or only its worker, paused before the first
+    // operation, if paused.
+    bool start(const Algorithm &, bool paused = false);
     bool stop();
     bool pause();
     bool resume();
+    // Lets a paused run perform this many more operations, i.e.
+    // comparisons, reads and assignments, and pauses it again.
+    bool step(std::uint64_t ops);
     void setDelay(std::chrono::microseconds);
 
   signals:
     void stateChanged(Run::State);
     void sceneChangesReady(SceneChanges &);
     void statsReady(Run::Stats);
+    void heatmapReady(const QImage &);
+    // Emitted by the worker when it stops at a breakpoint or after the
+    // last step.
+    void workerPaused();
+
+  public:
+    // Paces the drains of changes while running.  Should be told when
+    // the view has painted the changes.
+    FramePacer *framePacer() const;
 
-  protected:
-    void timerEvent(QTimerEvent *) override;
+  private slots:
+    void onFrameRequested();
+    void onWorkerPaused();
 
   private:
     void maybeDrainChanges(bool force = false);
@@ -56,19 +119,58 @@ class Run : public QObject {
     class Callbacks;
     friend class Callbacks;
 
+    // Operation counts of one thread running the algorithm.  Only
+    // written by that thread, so counting needs no locks.
+    struct ThreadCounters {
+        std::atomic<std::uint64_t> reads = 0;
+        std::atomic<std::uint64_t> writes = 0;
+        std::atomic<std::uint64_t> swaps = 0;
+        std::atomic<std::uint64_t> copies = 0;
+        std::atomic<std::uint64_t> moves = 0;
+        std::atomic<std::uint64_t> comparisons = 0;
+        std::atomic<std::uint64_t> auxAccesses = 0;
+    };
+
+    ThreadCounters &countersForCurrentThread();
+    void addCounts(Stats &) const;
+
     std::vector<SortItem> &m_vector;
     State m_state;
-    int m_timer;
+    FramePacer *m_pacer;
     Callbacks *m_callbacks;
     WorkerThread *m_thread;
+    std::size_t m_selectionK = 1;
+    AllocationTracker m_allocations;
+    AccessHeatmap m_heatmap;
+    // Accesses when the heatmap was last rendered.
+    std::uint64_t m_heatmapAccesses = 0;
+
+    // Distinguishes runs in the thread-local counters cache.
+    const std::uint64_t m_id;
+    // Guards the list, not the counters.
+    mutable QMutex m_countersMutex;
+    std::vector<std::unique_ptr<ThreadCounters>> m_threadCounters;
+
+    QElapsedTimer m_rateTimer;
+    std::uint64_t m_lastAccesses = 0;
 
     struct Shared {
         QMutex mutex;
+        // Wakes up the worker while paused, or to stop or pause it while
+        // waiting out the delay.
+        QWaitCondition wakeUp;
         bool stopRequested;
         bool pauseRequested;
+        // Operations the worker may perform while paused.
+        std::uint64_t steps;
+        std::optional<Breakpoint> breakpoint;
         std::chrono::microseconds delay;
         SceneChanges sceneChanges;
-        Stats stats;
+        std::optional<CacheSimulator> cache;
+        // Registered auxiliary buffers by their first item, with their
+        // lane and size.
+        std::map<const SortItem *, std::pair<int, std::size_t>> lanes;
+        int nextLane = 0;
     } shared;
 };
 
@@ -0,0 +1,291 @@
+#include "Scaling.h"
+#include "Affinity.h"
+
+#include <QElapsedTimer>
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+
+// Space around the plot, besides the labels.
+static constexpr int ChartMargin = 8;
+// Points the n log n line is drawn with.
+static constexpr int ReferencePoints = 32;
+
+QString ScalingPoint::series() const {
+    return QString("%1, %2").arg(algorithm, arrayOrderName(order));
+}
+
+QVector<int> ScalingPlan::sizes() const {
+    QVector<int> sizes;
+    if (factor <= 1) {
+        sizes.append(minSize);
+        return sizes;
+    }
+    for (double size = std::max(minSize, 1); std::lround(size) <= maxSize;
+         size *= factor) {
+        const int n = std::lround(size);
+        if (sizes.isEmpty() || sizes.last() != n) {
+            sizes.append(n);
+        }
+    }
+    return sizes;
+}
+
+// Returns nothing if the algorithm didn't sort the items.
+static std::optional<ScalingPoint> measurePoint(const Algorithm &algorithm,
+                                                ArrayOrder order, int size,
+                                                const ScalingPlan &plan) {
+    const auto items = generateVector(size, order, plan.seed, plan.swaps);
+    const auto k = SelectionK().forSize(size);
+    const bool plainKeys =
+        algorithm.sortInt32 && algorithm.selection == SelectionKind::None;
+    const std::vector<std::int32_t> keys =
+        plainKeys ? std::vector<std::int32_t>(items.begin(), items.end())
+                  : std::vector<std::int32_t>();
+
+    const auto measurement =
+        measure(plan.measurement, [&](int) -> std::optional<qint64> {
+            QElapsedTimer timer;
+            if (plainKeys) {
+                auto vec = keys;
+                timer.start();
+                algorithm.sortInt32(vec);
+                const auto nsecs = timer.nsecsElapsed();
+                if (!std::is_sorted(vec.begin(), vec.end())) {
+                    return std::nullopt;
+                }
+                return nsecs;
+            }
+            auto vec = items;
+            timer.start();
+            algorithm.run(vec, k);
+            const auto nsecs = timer.nsecsElapsed();
+            if (!algorithm.isDone(vec, k)) {
+                return std::nullopt;
+            }
+            return nsecs;
+        });
+    if (!measurement) {
+        return std::nullopt;
+    }
+
+    ScalingPoint point{.algorithm = algorithm.name,
+                       .order = order,
+                       .size = size,
+                       .nsecs = measurement->median};
+
+    // Callbacks are per thread, so the workers of parallel algorithms
+    // wouldn't be counted.
+    if (!algorithm.parallel) {
+        auto vec = items;
+        OperationCounts counts;
+        OperationCounter counter(counts);
+        SortItem::setCallbacksForCurrentThread(&counter);
+        algorithm.run(vec, k);
+        SortItem::setCallbacksForCurrentThread(nullptr);
+        // Writes include those of temporaries.
+        point.operations = counts.comparisons + counts.writes;
+    }
+    return point;
+}
+
+ScalingWorker::ScalingWorker(const ScalingPlan &plan, QObject *parent)
+    : QThread(parent), m_plan(plan) {}
+
+void ScalingWorker::cancel() { m_cancelled = true; }
+
+void ScalingWorker::run() {
+    if (const auto error = applyToCurrentThread(threadPlacement());
+        !error.isEmpty()) {
+        fprintf(stderr, "%s\n", qPrintable(error));
+    }
+
+    struct Case {
+        const Algorithm *algorithm;
+        ArrayOrder order;
+        int size;
+    };
+    std::vector<Case> cases;
+    for (int size : m_plan.sizes()) {
+        for (auto order : m_plan.orders) {
+            for (const auto *algorithm : m_plan.algorithms) {
+                if (algorithm->recommendedFor(size)) {
+                    cases.push_back({algorithm, order, size});
+                }
+            }
+        }
+    }
+
+    const int total = cases.size();
+    emit progress(0, total);
+    for (int i = 0; i < total && !m_cancelled; i++) {
+        const auto &c = cases[i];
+        if (const auto point =
+                measurePoint(*c.algorithm, c.order, c.size, m_plan)) {
+            emit pointReady(*point);
+        } else {
+            fprintf(stderr, "%s didn't sort %d %s items\n",
+                    qPrintable(c.algorithm->name), c.size,
+                    qPrintable(arrayOrderName(c.order)));
+        }
+        emit progress(i + 1, total);
+    }
+}
+
+ScalingChart::ScalingChart(QWidget *parent) : QWidget(parent) {}
+
+void ScalingChart::setMetric(Metric metric) {
+    m_metric = metric;
+    update();
+}
+
+QSize ScalingChart::sizeHint() const { return QSize(400, 300); }
+
+double ScalingChart::valueOf(const ScalingPoint &point) const {
+    return m_metric == Metric::Time ? point.nsecs : point.operations;
+}
+
+void ScalingChart::addPoint(ScalingPoint point) {
+    const double value = valueOf(point);
+    // Nothing to plot on a log scale.
+    if (value <= 0 || point.size <= 1) {
+        return;
+    }
+
+    const auto name = point.series();
+    auto series = std::find_if(m_series.begin(), m_series.end(),
+                               [&](const auto &s) { return s.first == name; });
+    if (series == m_series.end()) {
+        m_series.append({name, {}});
+        series = m_series.end() - 1;
+    }
+    series->second[point.size] = value;
+    update();
+}
+
+void ScalingChart::clear() {
+    m_series.clear();
+    update();
+}
+
+void ScalingChart::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+    const auto textColor = palette().text().color();
+    painter.setPen(textColor);
+
+    const QFontMetrics metrics(font());
+    const int lineHeight = metrics.height();
+    painter.drawText(QPointF(ChartMargin, ChartMargin + metrics.ascent()),
+                     m_metric == Metric::Time ? "Median time (ns)"
+                                              : "Comparisons and writes");
+    if (m_series.empty()) {
+        return;
+    }
+
+    // Bounds of the log10 of sizes and values.
+    double minX = INFINITY, maxX = -INFINITY;
+    double minY = INFINITY, maxY = -INFINITY;
+    for (const auto &[name, values] : m_series) {
+        for (const auto &[size, value] : values) {
+            minX = std::min(minX, std::log10(size));
+            maxX = std::max(maxX, std::log10(size));
+            minY = std::min(minY, std::log10(value));
+            maxY = std::max(maxY, std::log10(value));
+        }
+    }
+    if (maxX - minX < 0.1) {
+        minX -= 0.5;
+        maxX += 0.5;
+    }
+    if (maxY - minY < 0.1) {
+        minY -= 0.5;
+        maxY += 0.5;
+    }
+
+    const int left = ChartMargin + metrics.horizontalAdvance("1e-00") + 4;
+    const int top = ChartMargin + lineHeight * (m_series.size() + 1);
+    const QRectF plot(left, top, width() - left - ChartMargin,
+                      height() - top - ChartMargin - lineHeight);
+    if (plot.width() <= 0 || plot.height() <= 0) {
+        return;
+    }
+    const auto toPoint = [&](double size, double value) {
+        return QPointF(
+            plot.left() + (std::log10(size) - minX) / (maxX - minX) *
+                              plot.width(),
+            plot.bottom() - (std::log10(value) - minY) / (maxY - minY) *
+                                plot.height());
+    };
+
+    // Decades of both axes.
+    painter.setPen(Qt::lightGray);
+    for (int e = std::ceil(minX); e <= std::floor(maxX); e++) {
+        const double x = toPoint(std::pow(10, e), 1).x();
+        painter.drawLine(QPointF(x, plot.top()), QPointF(x, plot.bottom()));
+    }
+    for (int e = std::ceil(minY); e <= std::floor(maxY); e++) {
+        const double y = toPoint(1, std::pow(10, e)).y();
+        painter.drawLine(QPointF(plot.left(), y), QPointF(plot.right(), y));
+    }
+    painter.setPen(textColor);
+    painter.drawRect(plot);
+    for (int e = std::ceil(minX); e <= std::floor(maxX); e++) {
+        const double x = toPoint(std::pow(10, e), 1).x();
+        painter.drawText(QPointF(x, plot.bottom() + lineHeight),
+                         QString("1e%1").arg(e));
+    }
+    for (int e = std::ceil(minY); e <= std::floor(maxY); e++) {
+        const double y = toPoint(1, std::pow(10, e)).y();
+        painter.drawText(QPointF(ChartMargin, y + metrics.ascent() / 2),
+                         QString("1e%1").arg(e));
+    }
+
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setClipRect(plot);
+
+    // Through the first point of the first series.
+    const auto &[firstSize, firstValue] = *m_series.front().second.begin();
+    const double scale = firstValue / (firstSize * std::log2(firstSize));
+    QVector<QPointF> reference;
+    for (int i = 0; i < ReferencePoints; i++) {
+        const double size =
+            std::pow(10, minX + (maxX - minX) * i / (ReferencePoints - 1));
+        if (size > 1) {
+            reference.append(toPoint(size, scale * size * std::log2(size)));
+        }
+    }
+    QPen referencePen(textColor);
+    referencePen.setStyle(Qt::DashLine);
+    painter.setPen(referencePen);
+    painter.drawPolyline(reference.data(), reference.size());
+
+    for (int i = 0; i < m_series.size(); i++) {
+        const auto color =
+            QColor::fromHsv(i * 360 / m_series.size(), 200, 200);
+        QVector<QPointF> points;
+        for (const auto &[size, value] : m_series[i].second) {
+            points.append(toPoint(size, value));
+        }
+        painter.setPen(QPen(color, 2));
+        painter.drawPolyline(points.data(), points.size());
+        for (const auto &point : points) {
+            painter.drawEllipse(point, 2, 2);
+        }
+    }
+
+    // Legend under the title.
+    painter.setClipRect(rect());
+    for (int i = 0; i < m_series.size(); i++) {
+        painter.setPen(QColor::fromHsv(i * 360 / m_series.size(), 200, 200));
+        painter.drawText(
+            QPointF(ChartMargin, ChartMargin + metrics.ascent() +
+                                     lineHeight * (i + 1)),
+            m_series[i].first);
+    }
+    painter.setPen(referencePen);
+    painter.drawText(QPointF(plot.right() - metrics.horizontalAdvance(
+                                                "n log n") - 4,
+                             ChartMargin + metrics.ascent()),
+                     "n log n");
+}
@@ -0,0 +1,99 @@
+/* -*- mode: c++; -*- */
+#ifndef SCALING_H
+#define SCALING_H
+
+#include "Algorithms.h"
+#include "Measurement.h"
+#include "SortItem.h"
+
+#include <QThread>
+#include <QVector>
+#include <QWidget>
+#include <atomic>
+#include <map>
+
+// An algorithm sorting items of one order and size.
+struct ScalingPoint {
+    QString algorithm;
+    ArrayOrder order = ArrayOrder::Random;
+    int size = 0;
+    // Median time, sorting plain int32 keys if the algorithm has a
+    // kernel for them, else items without instrumentation.
+    double nsecs = 0;
+    // Comparisons and writes of an instrumented run.
+    std::uint64_t operations = 0;
+
+    // Name of the curve the point is on, e.g. "QuickSort, Random".
+    QString series() const;
+};
+
+// Each algorithm on each order, at sizes from minSize to maxSize
+// growing by factor.
+struct ScalingPlan {
+    QVector<const Algorithm *> algorithms;
+    QVector<ArrayOrder> orders;
+    int minSize = 1000;
+    int maxSize = 1000000;
+    double factor = 2;
+    std::uint64_t seed = 0;
+    std::optional<std::uint64_t> swaps;
+    MeasurementOptions measurement;
+
+    QVector<int> sizes() const;
+};
+
+// Measures a plan off the GUI thread, one point at a time so that runs
+// don't compete, and size by size so that all curves grow together.
+// Algorithms are skipped at sizes outside of their recommended range.
+class ScalingWorker : public QThread {
+    Q_OBJECT
+
+  public:
+    ScalingWorker(const ScalingPlan &, QObject *parent = nullptr);
+
+    // Stops after the point being measured.
+    void cancel();
+
+  signals:
+    void pointReady(ScalingPoint);
+    void progress(int done, int total);
+
+  private:
+    void run() override;
+
+    ScalingPlan m_plan;
+    std::atomic<bool> m_cancelled = false;
+};
+
+// Log-log chart of one metric of the points against their size, with
+// a dashed n log n line through the first point for reference.
+class ScalingChart : public QWidget {
+    Q_OBJECT
+
+  public:
+    enum class Metric {
+        Time,
+        Operations,
+    };
+
+    ScalingChart(QWidget *parent = nullptr);
+
+    void setMetric(Metric);
+    QSize sizeHint() const override;
+
+  public slots:
+    void addPoint(ScalingPoint);
+    void clear();
+
+  protected:
+    void paintEvent(QPaintEvent *) override;
+
+  private:
+    double valueOf(const ScalingPoint &) const;
+
+    Metric m_metric = Metric::Time;
+    // Values by size, of each series in the order they were added.
+    QVector<std::pair<QString, std::map<int, double>>> m_series;
+};
+
+#endif
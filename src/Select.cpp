@@ -0,0 +1,194 @@
+#include "Select.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+// Partitions the items into those smaller than the pivot, those equal
+// to it and those larger, and returns the range of those equal.
+template <typename It>
+static std::pair<It, It> partitionAround(It begin, It end, It pivot) {
+    std::iter_swap(begin, pivot);
+    const auto lessEnd = std::partition(
+        begin + 1, end, [&](const auto &item) { return item < *begin; });
+    std::iter_swap(begin, lessEnd - 1);
+    const auto equalEnd = std::partition(
+        lessEnd, end, [&](const auto &item) { return item == *(lessEnd - 1); });
+    return {lessEnd - 1, equalEnd};
+}
+
+// Narrows [begin, end) down to the items equal to *nth, partitioning
+// around the pivots chosen by choosePivot(begin, end).
+template <typename It, typename ChoosePivot>
+static void selectImpl(It begin, It nth, It end, ChoosePivot choosePivot) {
+    while (end - begin > 1) {
+        const auto [equalBegin, equalEnd] =
+            partitionAround(begin, end, choosePivot(begin, end));
+        if (nth < equalBegin) {
+            end = equalBegin;
+        } else if (nth >= equalEnd) {
+            begin = equalEnd;
+        } else {
+            return;
+        }
+    }
+}
+
+template <typename It> static It medianOfThree(It a, It b, It c) {
+    if (*b < *a) {
+        std::swap(a, b);
+    }
+    if (*c < *b) {
+        std::swap(b, c);
+        if (*b < *a) {
+            std::swap(a, b);
+        }
+    }
+    return b;
+}
+
+// Tukey's ninther, the median of three medians of three, for larger
+// ranges.  A plain median of three of the ends and the middle degrades
+// to quadratic time on descending items, which the partitioning leaves
+// in an order where it keeps picking one of the largest items.
+template <typename It> static It ninther(It begin, It end) {
+    const auto size = end - begin;
+    const auto middle = begin + size / 2, last = end - 1;
+    if (size < 40) {
+        return medianOfThree(begin, middle, last);
+    }
+
+    const auto step = size / 8;
+    return medianOfThree(
+        medianOfThree(begin, begin + step, begin + 2 * step),
+        medianOfThree(middle - step, middle, middle + step),
+        medianOfThree(last - 2 * step, last - step, last));
+}
+
+template <typename It> static void insertionSort(It begin, It end) {
+    for (auto i = begin; i != end; i++) {
+        for (auto j = i; j != begin && *j < *(j - 1); j--) {
+            std::iter_swap(j, j - 1);
+        }
+    }
+}
+
+template <typename It> static void medianOfMediansSelect(It, It, It);
+
+// Moves the medians of groups of five items to the front, and returns
+// their median, which has at least 30% of the items on either side.
+template <typename It> static It medianOfMedians(It begin, It end) {
+    const auto size = end - begin;
+    if (size <= 5) {
+        insertionSort(begin, end);
+        return begin + size / 2;
+    }
+
+    auto medians = begin;
+    for (decltype(end - begin) i = 0; i < size; i += 5) {
+        const auto group = begin + i;
+        const auto groupEnd = group + std::min<decltype(size)>(5, size - i);
+        insertionSort(group, groupEnd);
+        std::iter_swap(medians++, group + (groupEnd - group) / 2);
+    }
+
+    const auto median = begin + (medians - begin) / 2;
+    medianOfMediansSelect(begin, median, medians);
+    return median;
+}
+
+template <typename It>
+static void medianOfMediansSelect(It begin, It nth, It end) {
+    selectImpl(begin, nth, end, medianOfMedians<It>);
+}
+
+// Floyd and Rivest's SELECT: partitions around an item which a
+// recursively selected sample places just below or above the k-th, so
+// that it is usually close to it, and the range shrinks fast.
+template <typename It> static void floydRivestImpl(It begin, It nth, It end) {
+    // Below this size, sampling costs more than it saves.
+    constexpr std::ptrdiff_t MinSampledSize = 600;
+
+    std::ptrdiff_t left = 0, right = end - begin - 1;
+    const std::ptrdiff_t k = nth - begin;
+    while (right > left) {
+        if (right - left > MinSampledSize) {
+            const double n = right - left + 1, i = k - left + 1;
+            const double z = std::log(n);
+            const double s = 0.5 * std::exp(2 * z / 3);
+            const double sd = 0.5 * std::sqrt(z * s * (n - s) / n) *
+                              (i < n / 2 ? -1 : 1);
+            const auto sampleLeft = std::clamp<std::ptrdiff_t>(
+                k - i * s / n + sd, left, k);
+            const auto sampleRight = std::clamp<std::ptrdiff_t>(
+                k + (n - i) * s / n + sd, k, right);
+            floydRivestImpl(begin + sampleLeft, nth, begin + sampleRight + 1);
+        }
+
+        const auto [equalBegin, equalEnd] = partitionAround(
+            begin + left, begin + right + 1, begin + k);
+        if (nth < equalBegin) {
+            right = equalBegin - begin - 1;
+        } else if (nth >= equalEnd) {
+            left = equalEnd - begin;
+        } else {
+            return;
+        }
+    }
+}
+
+namespace Select {
+
+void QuickSelect(std::vector<SortItem> &vec, std::size_t k) {
+    selectImpl(vec.begin(), vec.begin() + k - 1, vec.end(),
+               ninther<std::vector<SortItem>::iterator>);
+}
+
+// Quickselect, until it took more than twice as many rounds as halving
+// the range each time would, then median of medians.
+void IntroSelect(std::vector<SortItem> &vec, std::size_t k) {
+    int rounds = 2 * std::bit_width(vec.size());
+    selectImpl(vec.begin(), vec.begin() + k - 1, vec.end(),
+               [&](auto begin, auto end) {
+                   return rounds-- > 0 ? ninther(begin, end)
+                                       : medianOfMedians(begin, end);
+               });
+}
+
+void FloydRivest(std::vector<SortItem> &vec, std::size_t k) {
+    floydRivestImpl(vec.begin(), vec.begin() + k - 1, vec.end());
+}
+
+void MedianOfMedians(std::vector<SortItem> &vec, std::size_t k) {
+    medianOfMediansSelect(vec.begin(), vec.begin() + k - 1, vec.end());
+}
+
+void StdNthElement(std::vector<SortItem> &vec, std::size_t k) {
+    std::nth_element(vec.begin(), vec.begin() + k - 1, vec.end());
+}
+
+void StdPartialSort(std::vector<SortItem> &vec, std::size_t k) {
+    std::partial_sort(vec.begin(), vec.begin() + k, vec.end());
+}
+
+// Keeps the k smallest items seen so far in a max-heap at the front,
+// replacing its top by every smaller item of the rest.
+void HeapTopK(std::vector<SortItem> &vec, std::size_t k) {
+    const auto heapEnd = vec.begin() + k;
+    std::make_heap(vec.begin(), heapEnd);
+    for (auto it = heapEnd; it != vec.end(); it++) {
+        if (*it < vec.front()) {
+            std::pop_heap(vec.begin(), heapEnd);
+            std::iter_swap(heapEnd - 1, it);
+            std::push_heap(vec.begin(), heapEnd);
+        }
+    }
+    std::sort_heap(vec.begin(), heapEnd);
+}
+
+// Quickselect for the k-th item, then a sort of the items before it.
+void PartitionTopK(std::vector<SortItem> &vec, std::size_t k) {
+    QuickSelect(vec, k);
+    std::sort(vec.begin(), vec.begin() + k - 1);
+}
+
+} // namespace Select
@@ -0,0 +1,28 @@
+/* -*- mode: c++; -*- */
+#ifndef SELECT_H
+#define SELECT_H
+
+#include "SortItem.h"
+#include <cstddef>
+#include <vector>
+
+// Selection algorithms, which only order the items as far as needed to
+// find the k smallest of them, 1 <= k <= size.
+namespace Select {
+
+// Move the k-th smallest item to index k - 1, with no larger items
+// before it and no smaller items after it.
+void QuickSelect(std::vector<SortItem> &vec, std::size_t k);
+void IntroSelect(std::vector<SortItem> &vec, std::size_t k);
+void FloydRivest(std::vector<SortItem> &vec, std::size_t k);
+void MedianOfMedians(std::vector<SortItem> &vec, std::size_t k);
+void StdNthElement(std::vector<SortItem> &vec, std::size_t k);
+
+// Move the k smallest items to the front, sorted.
+void StdPartialSort(std::vector<SortItem> &vec, std::size_t k);
+void HeapTopK(std::vector<SortItem> &vec, std::size_t k);
+void PartitionTopK(std::vector<SortItem> &vec, std::size_t k);
+
+} // namespace Select
+
+#endif
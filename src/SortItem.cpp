@@ -1,35 +1,75 @@
 #include "SortItem.h"
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QScopeGuard>
+#include <cmath>
 #include <compare>
+#include <memory>
+#include <numbers>
 #include <qapplication.h>
 #include <random>
 #include <thread>
 
 static SortItemCallbacks DefaultCallbacks;
 thread_local SortItemCallbacks *SortItem::callbacks = &DefaultCallbacks;
+const ValueComparator *SortItem::comparator = nullptr;
 
 SortItem::SortItem(int value) : m_value(value), m_graphicsItem(nullptr) {}
 
+// Copies are new items, e.g. in an auxiliary buffer, so they aren't
+// drawn as the original.
 SortItem::SortItem(const SortItem &other)
-    : m_value(other.m_value), m_graphicsItem(other.m_graphicsItem) {}
+    : m_value(other.m_value), m_tag(other.m_tag), m_graphicsItem(nullptr) {
+    callbacks->onConstruction(*this, other, ItemTransfer::Copy);
+}
+
+SortItem::SortItem(SortItem &&other)
+    : m_value(other.m_value), m_tag(other.m_tag), m_graphicsItem(nullptr) {
+    callbacks->onConstruction(*this, other, ItemTransfer::Move);
+}
 
 SortItem &SortItem::operator=(const SortItem &rhs) {
     if (&rhs != this) {
-        callbacks->onAssignment(*this, m_value, rhs.m_value, &rhs);
+        callbacks->onAssignment(*this, m_value, rhs.m_value, rhs,
+                                ItemTransfer::Copy);
         m_value = rhs.m_value;
+        m_tag = rhs.m_tag;
+    }
+    return *this;
+}
+
+SortItem &SortItem::operator=(SortItem &&rhs) {
+    if (&rhs != this) {
+        callbacks->onAssignment(*this, m_value, rhs.m_value, rhs,
+                                ItemTransfer::Move);
+        m_value = rhs.m_value;
+        m_tag = rhs.m_tag;
     }
     return *this;
 }
 
 void SortItem::swap(SortItem &rhs) {
     if (&rhs != this) {
-        callbacks->onAssignment(*this, m_value, rhs.m_value, &rhs);
-        callbacks->onAssignment(rhs, rhs.m_value, m_value, this);
+        callbacks->onSwap(*this, rhs);
+        callbacks->onAssignment(*this, m_value, rhs.m_value, rhs,
+                                ItemTransfer::Swap);
+        callbacks->onAssignment(rhs, rhs.m_value, m_value, *this,
+                                ItemTransfer::Swap);
         std::swap(m_value, rhs.m_value);
+        std::swap(m_tag, rhs.m_tag);
     }
 }
 
+void SortItem::assignSilently(const SortItem &other) {
+    m_value = other.m_value;
+    m_tag = other.m_tag;
+}
+
+void SortItem::swapSilently(SortItem &other) {
+    std::swap(m_value, other.m_value);
+    std::swap(m_tag, other.m_tag);
+}
+
 int SortItem::value() const {
     callbacks->onAccess(*this);
     return m_value;
@@ -44,101 +84,390 @@ QGraphicsItem *SortItem::mutableGraphicsItem() const { return m_graphicsItem; }
 
 void SortItem::setGraphicsItem(QGraphicsItem *item) { m_graphicsItem = item; }
 
+std::uint32_t SortItem::tag() const { return m_tag; }
+
+void SortItem::setTag(std::uint32_t tag) { m_tag = tag; }
+
 std::strong_ordering SortItem::operator<=>(const SortItem &rhs) const {
     callbacks->onComparison(*this, rhs);
+    if (comparator) {
+        return comparator->compare(m_value, rhs.m_value);
+    }
     return std::strong_order(m_value, rhs.m_value);
 }
 
 bool SortItem::operator==(const SortItem &rhs) const {
     callbacks->onComparison(*this, rhs);
+    if (comparator) {
+        return comparator->compare(m_value, rhs.m_value) == 0;
+    }
     return m_value == rhs.m_value;
 }
 
 void SortItem::setCallbacksForCurrentThread(SortItemCallbacks *cbs) {
-    callbacks = cbs;
+    callbacks = cbs ? cbs : &DefaultCallbacks;
+}
+
+void SortItem::setComparator(const ValueComparator *cmp) { comparator = cmp; }
+
+int SortItemCallbacks::valueOf(const SortItem &item) { return item.m_value; }
+
+void SortItemCallbacks::onRangeCopy(std::span<const SortItem> to,
+                                    std::span<const SortItem> from,
+                                    ItemTransfer transfer) {
+    for (std::size_t i = 0; i < to.size(); i++) {
+        onAssignment(to[i], valueOf(to[i]), valueOf(from[i]), from[i],
+                     transfer);
+    }
+}
+
+void SortItemCallbacks::onRotate(std::span<const SortItem> items,
+                                 std::size_t middle) {
+    for (std::size_t i = 0; i < items.size(); i++) {
+        const auto &from = items[(i + middle) % items.size()];
+        onAssignment(items[i], valueOf(items[i]), valueOf(from), from,
+                     ItemTransfer::Move);
+    }
+}
+
+void SortItemCallbacks::onSwapRanges(std::span<const SortItem> a,
+                                     std::span<const SortItem> b) {
+    for (std::size_t i = 0; i < a.size(); i++) {
+        onSwap(a[i], b[i]);
+        onAssignment(a[i], valueOf(a[i]), valueOf(b[i]), b[i],
+                     ItemTransfer::Swap);
+        onAssignment(b[i], valueOf(b[i]), valueOf(a[i]), a[i],
+                     ItemTransfer::Swap);
+    }
+}
+
+void OperationCounter::onComparison(const SortItem &, const SortItem &) {
+    m_counts.comparisons++;
+    m_counts.reads += 2;
 }
 
+void OperationCounter::onSwap(const SortItem &, const SortItem &) {
+    m_counts.swaps++;
+}
+
+void OperationCounter::onAccess(const SortItem &) { m_counts.reads++; }
+
+void OperationCounter::onAssignment(const SortItem &, int, int,
+                                    const SortItem &, ItemTransfer transfer) {
+    countWrite(transfer);
+}
+
+void OperationCounter::onConstruction(const SortItem &, const SortItem &,
+                                      ItemTransfer transfer) {
+    countWrite(transfer);
+}
+
+void OperationCounter::countWrite(ItemTransfer transfer) {
+    m_counts.reads++;
+    m_counts.writes++;
+    if (transfer == ItemTransfer::Copy) {
+        m_counts.copies++;
+    } else if (transfer == ItemTransfer::Move) {
+        m_counts.moves++;
+    }
+}
+
+AuxBuffer::AuxBuffer(std::span<const SortItem> items) : m_items(items) {
+    SortItem::callbacks->onBufferCreated(m_items);
+}
+
+AuxBuffer::~AuxBuffer() { SortItem::callbacks->onBufferDestroyed(m_items); }
+
 namespace std {
 void swap(SortItem &lhs, SortItem &rhs) { lhs.swap(rhs); }
 } // namespace std
 
-std::vector<SortItem> generateVector(int numItems, ArrayOrder order) {
-    std::vector<SortItem> ret;
+// Like memmove().
+void SortItem::transferItems(std::span<const SortItem> from, SortItem *to,
+                             ItemTransfer transfer) {
+    if (from.empty() || from.data() == to) {
+        return;
+    }
+    callbacks->onRangeCopy({to, from.size()}, from, transfer);
+    if (to < from.data()) {
+        for (std::size_t i = 0; i < from.size(); i++) {
+            to[i].assignSilently(from[i]);
+        }
+    } else {
+        for (auto i = from.size(); i-- > 0;) {
+            to[i].assignSilently(from[i]);
+        }
+    }
+}
 
-    switch (order) {
-    case ArrayOrder::Ascending:
-        for (int i = 0; i < numItems; i++) {
-            ret.emplace_back(i);
+void copyItems(std::span<const SortItem> from, SortItem *to) {
+    SortItem::transferItems(from, to, ItemTransfer::Copy);
+}
+
+void moveItems(std::span<SortItem> from, SortItem *to) {
+    SortItem::transferItems(from, to, ItemTransfer::Move);
+}
+
+void rotateItems(std::span<SortItem> items, std::size_t middle) {
+    if (middle == 0 || middle >= items.size()) {
+        return;
+    }
+    SortItem::callbacks->onRotate(items, middle);
+    auto reverse = [](std::span<SortItem> range) {
+        for (std::size_t i = 0, j = range.size(); i + 1 < j; i++, j--) {
+            range[i].swapSilently(range[j - 1]);
         }
-        break;
-    case ArrayOrder::Descending:
-        for (int i = numItems - 1; i >= 0; i--) {
-            ret.emplace_back(i);
+    };
+    reverse(items.first(middle));
+    reverse(items.subspan(middle));
+    reverse(items);
+}
+
+void swapItemRanges(std::span<SortItem> items, SortItem *other) {
+    if (items.empty()) {
+        return;
+    }
+    SortItem::callbacks->onSwapRanges(items, {other, items.size()});
+    for (std::size_t i = 0; i < items.size(); i++) {
+        items[i].swapSilently(other[i]);
+    }
+}
+
+// Fewer items per thread aren't worth starting a thread for.
+static constexpr std::size_t MinItemsPerThread = 1 << 16;
+
+// Calls func(begin, end) for consecutive chunks of [0, size), on all
+// cores.
+template <typename Func>
+static void parallelFor(std::size_t size, const Func &func) {
+    const std::size_t numThreads = std::clamp<std::size_t>(
+        size / MinItemsPerThread, 1,
+        std::max(1u, std::thread::hardware_concurrency()));
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < numThreads; i++) {
+        threads.emplace_back(func, size * i / numThreads,
+                             size * (i + 1) / numThreads);
+    }
+    func(0, size / numThreads);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+// The finalizer of SplitMix64, which mixes every input bit into every
+// output bit.
+static std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111eb;
+    x ^= x >> 31;
+    return x;
+}
+
+// Counter-based random numbers: the n-th number doesn't depend on the
+// ones before it, so any range of them can be generated on its own.
+class CounterRandom {
+  public:
+    CounterRandom(std::uint64_t seed, std::uint64_t stream)
+        : m_key(mix(seed ^ mix(stream))) {}
+
+    std::uint64_t operator()(std::uint64_t counter) const {
+        return mix(m_key + counter * 0x9e3779b97f4a7c15);
+    }
+
+    // Uniform in [0, 1).
+    double uniform(std::uint64_t counter) const {
+        return ((*this)(counter) >> 11) * 0x1.0p-53;
+    }
+
+  private:
+    std::uint64_t m_key;
+};
+
+// A random permutation of [0, size), evaluated one index at a time: a
+// Feistel network over the smallest even number of bits covering size,
+// reapplied to indices which land outside of it.  Since the network is
+// a permutation of at most 4 * size indices, that takes fewer than 4
+// rounds on average.
+class RandomPermutation {
+  public:
+    RandomPermutation(std::uint64_t size, std::uint64_t seed) : m_size(size) {
+        int bits = 2;
+        while (bits < 64 && (std::uint64_t(1) << bits) < size) {
+            bits += 2;
         }
-        break;
-    case ArrayOrder::Random: {
-        for (int i = 0; i < numItems; i++) {
-            ret.emplace_back(i);
+        m_halfBits = bits / 2;
+        m_halfMask = (std::uint64_t(1) << m_halfBits) - 1;
+        for (int i = 0; i < Rounds; i++) {
+            m_keys[i] = mix(seed + i);
         }
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(ret.begin(), ret.end(), g);
+    }
 
-        break;
+    std::uint64_t operator()(std::uint64_t index) const {
+        do {
+            index = encrypt(index);
+        } while (index >= m_size);
+        return index;
     }
-    case ArrayOrder::MostlySorted: {
-        for (int i = 0; i < numItems; i++) {
-            ret.emplace_back(i);
+
+  private:
+    static constexpr int Rounds = 4;
+
+    std::uint64_t encrypt(std::uint64_t index) const {
+        std::uint64_t left = index >> m_halfBits, right = index & m_halfMask;
+        for (auto key : m_keys) {
+            const auto next = left ^ (mix(right ^ key) & m_halfMask);
+            left = right;
+            right = next;
         }
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::uniform_int_distribution<int> uid(1, 9);
+        return (left << m_halfBits) | right;
+    }
 
-        auto it = ret.begin();
+    std::uint64_t m_size;
+    int m_halfBits;
+    std::uint64_t m_halfMask;
+    std::uint64_t m_keys[Rounds];
+};
 
-        while (it < ret.end()) {
-            int size = uid(g);
-            auto end = it + size;
-            while (end > ret.end()) {
-                end--;
+std::uint64_t randomSeed() {
+    std::random_device rd;
+    return (std::uint64_t(rd()) << 32) | rd();
+}
+
+void generateValues(std::span<int> values, ArrayOrder order,
+                    std::uint64_t seed, std::optional<std::uint64_t> swaps) {
+    const std::uint64_t n = values.size();
+    const CounterRandom random(seed, static_cast<int>(order));
+
+    auto fill = [&](const auto &valueAt) {
+        parallelFor(n, [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; i++) {
+                values[i] = valueAt(i);
             }
-            std::shuffle(it, end, g);
-            it = end;
-        }
+        });
+    };
 
+    switch (order) {
+    case ArrayOrder::Ascending:
+        fill([](std::uint64_t i) { return i; });
+        break;
+    case ArrayOrder::Descending:
+        fill([&](std::uint64_t i) { return n - 1 - i; });
+        break;
+    case ArrayOrder::Random:
+        fill(RandomPermutation(n, seed));
+        break;
+    case ArrayOrder::MostlySorted: {
+        // Ascending, but shuffled within blocks of a few items.
+        constexpr std::uint64_t BlockSize = 8;
+        fill([&](std::uint64_t i) {
+            const auto first = i / BlockSize * BlockSize;
+            const RandomPermutation permutation(
+                std::min(BlockSize, n - first), mix(seed ^ first));
+            return first + permutation(i - first);
+        });
         break;
     }
     case ArrayOrder::PartiallySorted: {
-        std::vector<int> values;
-        for (int i = 0; i < numItems; i++) {
-            values.emplace_back(i);
-        }
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::uniform_int_distribution<int> uid(0, numItems / 3);
+        // Random, with sorted runs of up to a third of the items
+        // separated by random gaps of up to the same length.
+        fill(RandomPermutation(n, seed));
 
-        std::shuffle(values.begin(), values.end(), g);
-
-        auto it = values.begin() + uid(g);
-
-        while (it < values.end()) {
-            int size = uid(g);
-            auto end = it + size;
-            while (end > values.end()) {
-                end--;
+        std::mt19937_64 g(seed);
+        std::uniform_int_distribution<std::uint64_t> uid(
+            1, std::max<std::uint64_t>(1, n / 3));
+        std::vector<std::thread> threads;
+        for (auto first = uid(g) - 1; first < n;) {
+            const auto last = std::min(n, first + uid(g));
+            auto sortRun = [=] {
+                std::sort(values.begin() + first, values.begin() + last);
+            };
+            if (last - first >= MinItemsPerThread) {
+                threads.emplace_back(sortRun);
+            } else {
+                sortRun();
             }
-            std::sort(it, end);
-            end += uid(g);
-            it = end;
+            first = last + uid(g);
         }
-
-        for (auto v : values) {
-            ret.emplace_back(v);
+        for (auto &thread : threads) {
+            thread.join();
         }
-
         break;
     }
+    case ArrayOrder::FewUnique: {
+        constexpr std::uint64_t NumUnique = 16;
+        fill([&](std::uint64_t i) {
+            return random(i) % NumUnique * n / NumUnique;
+        });
+        break;
     }
+    case ArrayOrder::Zipf:
+        // Value k occurs with a probability of about 1 / (k + 1), by
+        // inverting the distribution's continuous approximation.
+        fill([&](std::uint64_t i) {
+            const auto value =
+                std::uint64_t(std::pow(double(n) + 1, random.uniform(i))) - 1;
+            return std::min(value, n - 1);
+        });
+        break;
+    case ArrayOrder::Gaussian:
+        // Box-Muller transform, centered with a standard deviation of an
+        // eighth of the items.
+        fill([&](std::uint64_t i) {
+            const double z =
+                std::sqrt(-2 * std::log(1 - random.uniform(2 * i))) *
+                std::cos(2 * std::numbers::pi * random.uniform(2 * i + 1));
+            return std::clamp<std::int64_t>(std::llround(n / 2.0 + z * n / 8),
+                                            0, n - 1);
+        });
+        break;
+    case ArrayOrder::OrganPipe:
+        fill([&](std::uint64_t i) { return 2 * std::min(i, n - 1 - i); });
+        break;
+    case ArrayOrder::Sawtooth: {
+        constexpr std::uint64_t NumTeeth = 8;
+        const auto toothSize = std::max<std::uint64_t>(
+            1, (n + NumTeeth - 1) / NumTeeth);
+        fill([&](std::uint64_t i) { return i % toothSize * n / toothSize; });
+        break;
+    }
+    case ArrayOrder::AllEqual:
+        fill([&](std::uint64_t) { return n / 2; });
+        break;
+    case ArrayOrder::SortedWithSwaps: {
+        // Ascending, with a number of items, by default one in a
+        // hundred, swapped with a random other one.
+        fill([](std::uint64_t i) { return i; });
+        const auto numSwaps = swaps.value_or(n / 100 + 1);
+        for (std::uint64_t i = 0; n > 1 && i < numSwaps; i++) {
+            std::swap(values[random(2 * i) % n], values[random(2 * i + 1) % n]);
+        }
+        break;
+    }
+    }
+}
 
+std::vector<SortItem> generateVector(int numItems, ArrayOrder order,
+                                     std::uint64_t seed,
+                                     std::optional<std::uint64_t> swaps) {
+    std::vector<int> values(numItems);
+    generateValues(values, order, seed, swaps);
+
+    std::vector<SortItem> ret(numItems);
+    parallelFor(numItems, [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; i++) {
+            // Assigning would be reported to the callbacks.
+            std::construct_at(&ret[i], values[i]);
+        }
+    });
     return ret;
 }
+
+std::optional<std::uint64_t> swapsOption(const QCommandLineParser &parser) {
+    if (!parser.isSet("swaps")) {
+        return std::nullopt;
+    }
+    return parser.value("swaps").toULongLong();
+}
@@ -5,18 +5,31 @@
 #include <QGraphicsItem>
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <random>
+#include <span>
 #include <vector>
 
+class QCommandLineParser;
+
 enum class ArrayOrder {
     Ascending,
     Descending,
     Random,
     MostlySorted,
-    PartiallySorted
+    PartiallySorted,
+    FewUnique,
+    Zipf,
+    Gaussian,
+    OrganPipe,
+    Sawtooth,
+    AllEqual,
+    SortedWithSwaps,
 };
 
-inline constexpr int ArrayOrderCount = 5;
+inline constexpr int ArrayOrderCount = 12;
 
 inline QString arrayOrderName(ArrayOrder order) {
     constexpr const char *ArrayOrderNames[] = {
@@ -26,20 +39,112 @@ inline QString arrayOrderName(ArrayOrder order) {
         "Random",
         "MostlySorted",
         "PartiallySorted",
+        "FewUnique",
+        "Zipf",
+        "Gaussian",
+        "OrganPipe",
+        "Sawtooth",
+        "AllEqual",
+        "SortedWithSwaps",
         // clang-format on
     };
     return ArrayOrderNames[int(order)];
 }
 
+inline std::optional<ArrayOrder> arrayOrderFromName(const QString &name) {
+    for (int i = 0; i < ArrayOrderCount; i++) {
+        if (arrayOrderName(static_cast<ArrayOrder>(i)) == name) {
+            return static_cast<ArrayOrder>(i);
+        }
+    }
+    return std::nullopt;
+}
+
 class SortItem;
 
+// How an item got the value of another.
+enum class ItemTransfer {
+    Copy,
+    Move,
+    // One half of a swap, see SortItemCallbacks::onSwap().
+    Swap,
+};
+
+// Every write of an item is reported once, either as an assignment or
+// as a construction, so that counts of writes, copies and moves mean
+// the same for all algorithms.
 struct SortItemCallbacks {
     virtual ~SortItemCallbacks() = default;
 
     virtual void onComparison(const SortItem &, const SortItem &) {}
+    // Followed by onAssignment() for both items.
+    virtual void onSwap(const SortItem &, const SortItem &) {}
     virtual void onAccess(const SortItem &) {}
-    virtual void onAssignment(const SortItem &, int, int,
-                              const SortItem * /*from*/ = nullptr) {}
+    // An existing item, e.g. one of the vector, is overwritten.
+    virtual void onAssignment(const SortItem &, int /*oldValue*/,
+                              int /*newValue*/, const SortItem & /*from*/,
+                              ItemTransfer) {}
+    // A new item, e.g. a temporary, is copied or moved from another.
+    // It isn't drawn, as it is no item of the vector or of a buffer yet.
+    virtual void onConstruction(const SortItem &, const SortItem & /*from*/,
+                                ItemTransfer) {}
+
+    // Block operations, see copyItems() and friends, reported before
+    // they happen.  By default, they're reported as the assignments and
+    // swaps they consist of.
+    virtual void onRangeCopy(std::span<const SortItem> to,
+                             std::span<const SortItem> from, ItemTransfer);
+    // The items are rotated left by middle, so that the item at middle
+    // becomes the first.  Reported as a move of every item.
+    virtual void onRotate(std::span<const SortItem>, std::size_t middle);
+    virtual void onSwapRanges(std::span<const SortItem>,
+                              std::span<const SortItem>);
+
+    // See AuxBuffer.
+    virtual void onBufferCreated(std::span<const SortItem>) {}
+    virtual void onBufferDestroyed(std::span<const SortItem>) {}
+
+  protected:
+    // Without reporting an access.
+    static int valueOf(const SortItem &);
+};
+
+// Operations on items, as the benchmarks count them.  Reads include
+// those of comparisons and writes.
+struct OperationCounts {
+    std::uint64_t comparisons = 0;
+    std::uint64_t reads = 0;
+    std::uint64_t writes = 0;
+    std::uint64_t swaps = 0;
+    std::uint64_t copies = 0;
+    std::uint64_t moves = 0;
+};
+
+// Adds the operations of the threads it is the callbacks of to counts.
+class OperationCounter : public SortItemCallbacks {
+  public:
+    OperationCounter(OperationCounts &counts) : m_counts(counts) {}
+
+    void onComparison(const SortItem &, const SortItem &) override;
+    void onSwap(const SortItem &, const SortItem &) override;
+    void onAccess(const SortItem &) override;
+    void onAssignment(const SortItem &, int, int, const SortItem &,
+                      ItemTransfer) override;
+    void onConstruction(const SortItem &, const SortItem &,
+                        ItemTransfer) override;
+
+  private:
+    void countWrite(ItemTransfer);
+
+    OperationCounts &m_counts;
+};
+
+// Orders the values of items instead of comparing them as ints, e.g.
+// to model more expensive comparisons.  Must order values as ints.
+struct ValueComparator {
+    virtual ~ValueComparator() = default;
+
+    virtual std::strong_ordering compare(int, int) const = 0;
 };
 
 class SortItem {
@@ -47,9 +152,14 @@ class SortItem {
     SortItem() = default;
     SortItem(int);
 
+    // Moves leave the value in place, as it's an int, but are reported
+    // as moves, which algorithms use for items they overwrite later.
+    // Not noexcept, as the callbacks may throw to interrupt a run.
     SortItem(const SortItem &);
+    SortItem(SortItem &&);
 
     SortItem &operator=(const SortItem &);
+    SortItem &operator=(SortItem &&);
     void swap(SortItem &);
 
     int value() const;
@@ -60,22 +170,113 @@ class SortItem {
     QGraphicsItem *mutableGraphicsItem() const;
     void setGraphicsItem(QGraphicsItem *item);
 
+    // Identifies an item independently of its value, e.g. by its index
+    // before sorting, to check stability.  Moves along with the value,
+    // without being reported to the callbacks.
+    std::uint32_t tag() const;
+    void setTag(std::uint32_t);
+
     std::strong_ordering operator<=>(const SortItem &rhs) const;
     bool operator==(const SortItem &rhs) const;
 
+    // nullptr restores the default callbacks, which do nothing.
     static void setCallbacksForCurrentThread(SortItemCallbacks *);
+    // nullptr compares values as ints.  Applies to all threads, so it
+    // must not change while anything is sorted.
+    static void setComparator(const ValueComparator *);
 
   private:
+    friend class AuxBuffer;
+    friend struct SortItemCallbacks;
+    friend void copyItems(std::span<const SortItem>, SortItem *);
+    friend void moveItems(std::span<SortItem>, SortItem *);
+    friend void rotateItems(std::span<SortItem>, std::size_t);
+    friend void swapItemRanges(std::span<SortItem>, SortItem *);
+
+    // Without reporting it to the callbacks.
+    void assignSilently(const SortItem &);
+    void swapSilently(SortItem &);
+    static void transferItems(std::span<const SortItem> from, SortItem *to,
+                              ItemTransfer);
+
     static thread_local SortItemCallbacks *callbacks;
+    static const ValueComparator *comparator;
 
     int m_value = 0;
+    std::uint32_t m_tag = 0;
     QGraphicsItem *m_graphicsItem = nullptr;
 };
 
+// Announces a buffer of items outside of the sorted vector, e.g. a
+// merge buffer, to the callbacks of the current thread while in
+// scope, so that it can be visualized.  The items must not move while
+// the buffer is registered.
+class AuxBuffer {
+  public:
+    AuxBuffer(std::span<const SortItem> items);
+    ~AuxBuffer();
+
+    AuxBuffer(const AuxBuffer &) = delete;
+    AuxBuffer &operator=(const AuxBuffer &) = delete;
+
+  private:
+    std::span<const SortItem> m_items;
+};
+
 namespace std {
 void swap(SortItem &, SortItem &);
 }
 
-std::vector<SortItem> generateVector(int numItems, ArrayOrder order);
+// Block operations, reported to the callbacks of the current thread as
+// one event each instead of one per item, which saves most of the
+// overhead of instrumentation for long blocks and shows a block as one
+// change.  Ranges may overlap as with memmove(), except for swaps.
+void copyItems(std::span<const SortItem> from, SortItem *to);
+void moveItems(std::span<SortItem> from, SortItem *to);
+void rotateItems(std::span<SortItem>, std::size_t middle);
+void swapItemRanges(std::span<SortItem>, SortItem *other);
+
+// Like their std:: counterparts, for iterators of contiguous items.
+template <typename In, typename Out>
+Out copyItems(In first, In last, Out to) {
+    copyItems({std::to_address(first), std::size_t(last - first)},
+              std::to_address(to));
+    return to + (last - first);
+}
+
+template <typename In, typename Out>
+Out moveItems(In first, In last, Out to) {
+    moveItems({std::to_address(first), std::size_t(last - first)},
+              std::to_address(to));
+    return to + (last - first);
+}
+
+template <typename It> void rotateItems(It first, It middle, It last) {
+    rotateItems({std::to_address(first), std::size_t(last - first)},
+                middle - first);
+}
+
+template <typename It1, typename It2>
+It2 swapItemRanges(It1 first1, It1 last1, It2 first2) {
+    swapItemRanges({std::to_address(first1), std::size_t(last1 - first1)},
+                   std::to_address(first2));
+    return first2 + (last1 - first1);
+}
+
+// Returns a seed for generateValues() from std::random_device.
+std::uint64_t randomSeed();
+
+// Fills values with values in [0, values.size()) in the given order, on
+// all cores.  SortedWithSwaps values get the given number of random
+// swaps, by default one per hundred values, plus one.  The values only
+// depend on the order, the seed and the swaps.
+void generateValues(std::span<int> values, ArrayOrder order,
+                    std::uint64_t seed, std::optional<std::uint64_t> swaps);
+std::vector<SortItem> generateVector(int numItems, ArrayOrder order,
+                                     std::uint64_t seed,
+                                     std::optional<std::uint64_t> swaps);
+
+// The swaps given with --swaps, which main() checks.
+std::optional<std::uint64_t> swapsOption(const QCommandLineParser &);
 
 #endif
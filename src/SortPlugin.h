@@ -0,0 +1,86 @@
+/* -*- mode: c; -*- */
+#ifndef SORT_PLUGIN_H
+#define SORT_PLUGIN_H
+
+/*
+ * C interface for loading additional sorting algorithms from shared
+ * objects.
+ *
+ * A plugin is a shared object placed in the plugin directory which
+ * exports SORT_PLUGIN_ENTRY_POINT.  The entry point returns an array
+ * of algorithm descriptors, which must stay valid for the lifetime of
+ * the process.
+ *
+ * The `sort' function receives the array through callbacks, so that
+ * every comparison and assignment is visible to the visualizer.  The
+ * raw kernels are optional and are only used by the benchmark
+ * harness.
+ *
+ * When a visualized run is stopped, the callbacks unwind the stack
+ * with a C++ exception, so plugins must be built with unwind tables
+ * (-fexceptions when written in C).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SORT_PLUGIN_ABI_VERSION 1
+#define SORT_PLUGIN_ENTRY_POINT "sort_plugin_algorithms"
+
+enum sort_plugin_flags {
+    SORT_PLUGIN_STABLE = 0x1,
+    SORT_PLUGIN_IN_PLACE = 0x2,
+    SORT_PLUGIN_PARALLEL = 0x4,
+};
+
+enum sort_plugin_aux_memory {
+    SORT_PLUGIN_AUX_CONSTANT,
+    SORT_PLUGIN_AUX_LOGARITHMIC,
+    SORT_PLUGIN_AUX_SQRT,
+    SORT_PLUGIN_AUX_LINEAR,
+};
+
+struct sort_plugin_array {
+    void *context;
+    size_t size;
+
+    /* Returns a negative value, zero or a positive value when the
+       element at i is less than, equal to or greater than the element
+       at j. */
+    int (*compare)(void *context, size_t i, size_t j);
+    void (*swap)(void *context, size_t i, size_t j);
+    int (*get)(void *context, size_t i);
+    void (*set)(void *context, size_t i, int value);
+};
+
+struct sort_plugin_algorithm {
+    const char *name;
+    unsigned flags;
+    int aux_memory;
+
+    /* Recommended size range, max_size of 0 means unbounded. */
+    size_t min_size;
+    size_t max_size;
+
+    void (*sort)(const struct sort_plugin_array *array);
+
+    /* Optional, may be NULL. */
+    void (*sort_int32)(int32_t *data, size_t size);
+    void (*sort_int64)(int64_t *data, size_t size);
+    void (*sort_float)(float *data, size_t size);
+};
+
+/* Stores the number of algorithms in *count and returns the array of
+   descriptors, or NULL if abi_version is not supported. */
+typedef const struct sort_plugin_algorithm *(*sort_plugin_entry_point)(
+    unsigned abi_version, size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
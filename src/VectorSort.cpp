@@ -0,0 +1,177 @@
+#include "VectorSort.h"
+#include "VectorSortImpl.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <type_traits>
+
+static const char *const TargetNames[] = {"scalar", "avx2", "avx512"};
+
+static std::atomic<VectorTarget> maxTarget = VectorTarget::Avx512;
+
+QString vectorTargetName(VectorTarget target) {
+    return TargetNames[int(target)];
+}
+
+std::optional<VectorTarget> vectorTargetFromName(const QString &name) {
+    for (int i = 0; i < int(std::size(TargetNames)); i++) {
+        if (name == TargetNames[i]) {
+            return static_cast<VectorTarget>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+static VectorTarget supportedTarget() {
+#ifdef HAVE_AVX512
+    if (__builtin_cpu_supports("avx512f")) {
+        return VectorTarget::Avx512;
+    }
+#endif
+#ifdef HAVE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return VectorTarget::Avx2;
+    }
+#endif
+    return VectorTarget::Scalar;
+}
+
+VectorTarget vectorTarget() {
+    static const VectorTarget supported = supportedTarget();
+    return std::min(supported, maxTarget.load());
+}
+
+void setMaxVectorTarget(VectorTarget target) { maxTarget = target; }
+
+template <typename T> void vectorSortFallback(T *keys, std::size_t size) {
+    std::make_heap(keys, keys + size);
+    std::sort_heap(keys, keys + size);
+}
+
+template void vectorSortFallback(std::int32_t *, std::size_t);
+template void vectorSortFallback(std::int64_t *, std::size_t);
+template void vectorSortFallback(float *, std::size_t);
+template void vectorSortFallback(SortItem *, std::size_t);
+
+namespace {
+
+// Registers of keys in memory, for CPUs without a kernel and for
+// items.  Partitioning several keys at a time still saves branches.
+template <typename Key> struct Scalar {
+    using T = Key;
+    static constexpr int Lanes = 8;
+    static constexpr int NetworkRegisters = 2;
+    struct Reg {
+        T keys[Lanes];
+    };
+
+    static T padding() {
+        if constexpr (std::is_same_v<T, SortItem>) {
+            return SortItem(std::numeric_limits<int>::max());
+        } else if constexpr (std::numeric_limits<T>::has_infinity) {
+            return std::numeric_limits<T>::infinity();
+        } else {
+            return std::numeric_limits<T>::max();
+        }
+    }
+
+    static Reg load(const T *p) {
+        Reg v;
+        std::copy(p, p + Lanes, v.keys);
+        return v;
+    }
+    static void store(T *p, const Reg &v) {
+        std::copy(v.keys, v.keys + Lanes, p);
+    }
+    static Reg broadcast(const T &key) {
+        Reg v;
+        std::fill(v.keys, v.keys + Lanes, key);
+        return v;
+    }
+    static Reg min(const Reg &a, const Reg &b) {
+        Reg v;
+        for (int i = 0; i < Lanes; i++) {
+            v.keys[i] = std::min(a.keys[i], b.keys[i]);
+        }
+        return v;
+    }
+    static Reg max(const Reg &a, const Reg &b) {
+        Reg v;
+        for (int i = 0; i < Lanes; i++) {
+            v.keys[i] = std::max(a.keys[i], b.keys[i]);
+        }
+        return v;
+    }
+    static unsigned lessMask(const Reg &v, const Reg &pivot) {
+        unsigned bits = 0;
+        for (int i = 0; i < Lanes; i++) {
+            bits |= unsigned(v.keys[i] < pivot.keys[i]) << i;
+        }
+        return bits;
+    }
+    static unsigned lessEqualMask(const Reg &v, const Reg &pivot) {
+        unsigned bits = 0;
+        for (int i = 0; i < Lanes; i++) {
+            bits |= unsigned(!(pivot.keys[i] < v.keys[i])) << i;
+        }
+        return bits;
+    }
+    static Reg permuteXor(const Reg &v, int j) {
+        Reg result;
+        for (int i = 0; i < Lanes; i++) {
+            result.keys[i] = v.keys[i ^ j];
+        }
+        return result;
+    }
+    static Reg blend(const Reg &a, const Reg &b, unsigned bits) {
+        Reg v;
+        for (int i = 0; i < Lanes; i++) {
+            v.keys[i] = (bits >> i) & 1 ? b.keys[i] : a.keys[i];
+        }
+        return v;
+    }
+    // Writes each key to both ends of the lanes left to fill, rather
+    // than branch, and the last write to each lane is the right one.
+    static void storePartitioned(T *left, T *right, const Reg &v,
+                                 unsigned bits, int) {
+        Reg partitioned;
+        int front = 0, back = Lanes - 1;
+        for (int i = 0; i < Lanes; i++) {
+            const bool goesLeft = (bits >> i) & 1;
+            partitioned.keys[front] = v.keys[i];
+            partitioned.keys[back] = v.keys[i];
+            front += goesLeft;
+            back -= !goesLeft;
+        }
+        store(left, partitioned);
+        store(right - Lanes, partitioned);
+    }
+};
+
+} // namespace
+
+template <typename T> static void dispatch(std::span<T> keys) {
+    switch (vectorTarget()) {
+#ifdef HAVE_AVX512
+    case VectorTarget::Avx512:
+        vectorSortAvx512(keys.data(), keys.size());
+        return;
+#endif
+#ifdef HAVE_AVX2
+    case VectorTarget::Avx2:
+        vectorSortAvx2(keys.data(), keys.size());
+        return;
+#endif
+    default:
+        QuickSortKernel<Scalar<T>>::sort(keys.data(), keys.size());
+    }
+}
+
+void vectorSort(std::span<std::int32_t> keys) { dispatch(keys); }
+void vectorSort(std::span<std::int64_t> keys) { dispatch(keys); }
+void vectorSort(std::span<float> keys) { dispatch(keys); }
+
+void VectorQuickSort(std::vector<SortItem> &vec) {
+    QuickSortKernel<Scalar<SortItem>>::sort(vec.data(), vec.size());
+}
@@ -0,0 +1,40 @@
+/* -*- mode: c++; -*- */
+#ifndef VECTORSORT_H
+#define VECTORSORT_H
+
+#include "SortItem.h"
+
+#include <QString>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Instruction sets the vectorized quicksort has kernels for, from the
+// least to the most capable.
+enum class VectorTarget {
+    Scalar,
+    Avx2,
+    Avx512,
+};
+
+QString vectorTargetName(VectorTarget);
+std::optional<VectorTarget> vectorTargetFromName(const QString &);
+
+// The most capable target the build and the CPU support, at most the
+// one set with setMaxVectorTarget().
+VectorTarget vectorTarget();
+void setMaxVectorTarget(VectorTarget);
+
+// Quicksort partitioning a vector of keys at a time, with a sorting
+// network for small ranges and for the sample the pivot is the median
+// of, on the kernel of vectorTarget().  Falls back to heapsort when
+// partitions are too uneven.
+void vectorSort(std::span<std::int32_t>);
+void vectorSort(std::span<std::int64_t>);
+void vectorSort(std::span<float>);
+
+// The scalar kernel on items, for the window and instrumentation.
+void VectorQuickSort(std::vector<SortItem> &);
+
+#endif
@@ -0,0 +1,182 @@
+// Compiled with -mavx2, and called only on CPUs which have it.
+#include "VectorSortImpl.h"
+
+#include <immintrin.h>
+
+namespace {
+
+// For each mask of Lanes lanes, indices of 32-bit elements which move
+// the lanes whose bits are set to the front, and the others after them.
+template <int Lanes> struct PermuteTable {
+    static constexpr int Width = 8 / Lanes;
+    alignas(32) std::int32_t indices[1 << Lanes][8] = {};
+};
+
+template <int Lanes> constexpr PermuteTable<Lanes> makePermuteTable() {
+    PermuteTable<Lanes> table;
+    for (int mask = 0; mask < (1 << Lanes); mask++) {
+        int n = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int lane = 0; lane < Lanes; lane++) {
+                if (bool(mask & (1 << lane)) != (pass == 0)) {
+                    continue;
+                }
+                for (int i = 0; i < table.Width; i++) {
+                    table.indices[mask][n++] = lane * table.Width + i;
+                }
+            }
+        }
+    }
+    return table;
+}
+
+constexpr auto Permute32 = makePermuteTable<8>();
+constexpr auto Permute64 = makePermuteTable<4>();
+
+// Indices of 32-bit elements which swap lanes j apart.
+__m256i xorIndices(int j) {
+    return _mm256_xor_si256(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                            _mm256_set1_epi32(j));
+}
+
+// All ones in the 32-bit lanes whose bits are set.
+__m256i laneMask32(unsigned bits) {
+    const auto laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm256_cmpeq_epi32(
+        _mm256_and_si256(_mm256_set1_epi32(bits), laneBits), laneBits);
+}
+
+// The lanes whose bits are set first.
+__m256i partitioned32(__m256i v, unsigned bits) {
+    return _mm256_permutevar8x32_epi32(
+        v, _mm256_load_si256((const __m256i *)Permute32.indices[bits]));
+}
+
+struct Int32 {
+    using T = std::int32_t;
+    using Reg = __m256i;
+    static constexpr int Lanes = 8;
+    static constexpr int NetworkRegisters = 4;
+
+    static T padding() { return INT32_MAX; }
+    static Reg load(const T *p) { return _mm256_loadu_si256((const Reg *)p); }
+    static void store(T *p, Reg v) { _mm256_storeu_si256((Reg *)p, v); }
+    static Reg broadcast(T key) { return _mm256_set1_epi32(key); }
+    static Reg min(Reg a, Reg b) { return _mm256_min_epi32(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm256_max_epi32(a, b); }
+    static unsigned lessMask(Reg v, Reg pivot) {
+        return _mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpgt_epi32(pivot, v)));
+    }
+    static unsigned lessEqualMask(Reg v, Reg pivot) {
+        return ~_mm256_movemask_ps(
+                   _mm256_castsi256_ps(_mm256_cmpgt_epi32(v, pivot))) &
+               0xff;
+    }
+    static Reg permuteXor(Reg v, int j) {
+        return _mm256_permutevar8x32_epi32(v, xorIndices(j));
+    }
+    static Reg blend(Reg a, Reg b, unsigned bits) {
+        return _mm256_blendv_epi8(a, b, laneMask32(bits));
+    }
+    // Stores all lanes on both sides, which the free space allows.
+    static void storePartitioned(T *left, T *right, Reg v, unsigned bits,
+                                 int) {
+        const Reg p = partitioned32(v, bits);
+        store(left, p);
+        store(right - Lanes, p);
+    }
+};
+
+struct Int64 {
+    using T = std::int64_t;
+    using Reg = __m256i;
+    static constexpr int Lanes = 4;
+    static constexpr int NetworkRegisters = 4;
+
+    static T padding() { return INT64_MAX; }
+    static Reg load(const T *p) { return _mm256_loadu_si256((const Reg *)p); }
+    static void store(T *p, Reg v) { _mm256_storeu_si256((Reg *)p, v); }
+    static Reg broadcast(T key) { return _mm256_set1_epi64x(key); }
+    // AVX2 lacks 64-bit min and max.
+    static Reg min(Reg a, Reg b) {
+        return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+    }
+    static Reg max(Reg a, Reg b) {
+        return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+    }
+    static unsigned lessMask(Reg v, Reg pivot) {
+        return _mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpgt_epi64(pivot, v)));
+    }
+    static unsigned lessEqualMask(Reg v, Reg pivot) {
+        return ~_mm256_movemask_pd(
+                   _mm256_castsi256_pd(_mm256_cmpgt_epi64(v, pivot))) &
+               0xf;
+    }
+    static Reg permuteXor(Reg v, int j) {
+        return _mm256_permutevar8x32_epi32(v, xorIndices(2 * j));
+    }
+    static Reg blend(Reg a, Reg b, unsigned bits) {
+        const auto laneBits = _mm256_setr_epi64x(1, 2, 4, 8);
+        return _mm256_blendv_epi8(
+            a, b,
+            _mm256_cmpeq_epi64(
+                _mm256_and_si256(_mm256_set1_epi64x(bits), laneBits),
+                laneBits));
+    }
+    static void storePartitioned(T *left, T *right, Reg v, unsigned bits,
+                                 int) {
+        const Reg p = _mm256_permutevar8x32_epi32(
+            v, _mm256_load_si256((const __m256i *)Permute64.indices[bits]));
+        store(left, p);
+        store(right - Lanes, p);
+    }
+};
+
+struct Float {
+    using T = float;
+    using Reg = __m256;
+    static constexpr int Lanes = 8;
+    static constexpr int NetworkRegisters = 4;
+
+    static T padding() { return __builtin_inff(); }
+    static Reg load(const T *p) { return _mm256_loadu_ps(p); }
+    static void store(T *p, Reg v) { _mm256_storeu_ps(p, v); }
+    static Reg broadcast(T key) { return _mm256_set1_ps(key); }
+    static Reg min(Reg a, Reg b) { return _mm256_min_ps(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+    static unsigned lessMask(Reg v, Reg pivot) {
+        return _mm256_movemask_ps(_mm256_cmp_ps(v, pivot, _CMP_LT_OQ));
+    }
+    static unsigned lessEqualMask(Reg v, Reg pivot) {
+        return _mm256_movemask_ps(_mm256_cmp_ps(v, pivot, _CMP_LE_OQ));
+    }
+    static Reg permuteXor(Reg v, int j) {
+        return _mm256_permutevar8x32_ps(v, xorIndices(j));
+    }
+    static Reg blend(Reg a, Reg b, unsigned bits) {
+        return _mm256_blendv_ps(a, b, _mm256_castsi256_ps(laneMask32(bits)));
+    }
+    static void storePartitioned(T *left, T *right, Reg v, unsigned bits,
+                                 int) {
+        const Reg p = _mm256_castsi256_ps(
+            partitioned32(_mm256_castps_si256(v), bits));
+        store(left, p);
+        store(right - Lanes, p);
+    }
+};
+
+} // namespace
+
+void vectorSortAvx2(std::int32_t *keys, std::size_t size) {
+    QuickSortKernel<Int32>::sort(keys, size);
+}
+
+void vectorSortAvx2(std::int64_t *keys, std::size_t size) {
+    QuickSortKernel<Int64>::sort(keys, size);
+}
+
+void vectorSortAvx2(float *keys, std::size_t size) {
+    QuickSortKernel<Float>::sort(keys, size);
+}
@@ -0,0 +1,135 @@
+// Compiled with -mavx512f, and called only on CPUs which have it.
+#include "VectorSortImpl.h"
+
+// GCC 12 takes the undefined registers the intrinsics start from for
+// uninitialized ones.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+// Indices of the lanes j apart.
+__m512i xorIndices32(int j) {
+    return _mm512_xor_si512(
+        _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+                          15),
+        _mm512_set1_epi32(j));
+}
+
+__m512i xorIndices64(int j) {
+    return _mm512_xor_si512(_mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7),
+                            _mm512_set1_epi64(j));
+}
+
+struct Int32 {
+    using T = std::int32_t;
+    using Reg = __m512i;
+    static constexpr int Lanes = 16;
+    static constexpr int NetworkRegisters = 4;
+
+    static T padding() { return INT32_MAX; }
+    static Reg load(const T *p) { return _mm512_loadu_si512(p); }
+    static void store(T *p, Reg v) { _mm512_storeu_si512(p, v); }
+    static Reg broadcast(T key) { return _mm512_set1_epi32(key); }
+    static Reg min(Reg a, Reg b) { return _mm512_min_epi32(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm512_max_epi32(a, b); }
+    static unsigned lessMask(Reg v, Reg pivot) {
+        return _mm512_cmplt_epi32_mask(v, pivot);
+    }
+    static unsigned lessEqualMask(Reg v, Reg pivot) {
+        return _mm512_cmple_epi32_mask(v, pivot);
+    }
+    static Reg permuteXor(Reg v, int j) {
+        return _mm512_permutexvar_epi32(xorIndices32(j), v);
+    }
+    static Reg blend(Reg a, Reg b, unsigned bits) {
+        return _mm512_mask_blend_epi32(bits, a, b);
+    }
+    static void storePartitioned(T *left, T *right, Reg v, unsigned bits,
+                                 int count) {
+        _mm512_mask_compressstoreu_epi32(left, bits, v);
+        _mm512_mask_compressstoreu_epi32(right - (Lanes - count), ~bits, v);
+    }
+};
+
+struct Int64 {
+    using T = std::int64_t;
+    using Reg = __m512i;
+    static constexpr int Lanes = 8;
+    static constexpr int NetworkRegisters = 4;
+
+    static T padding() { return INT64_MAX; }
+    static Reg load(const T *p) { return _mm512_loadu_si512(p); }
+    static void store(T *p, Reg v) { _mm512_storeu_si512(p, v); }
+    static Reg broadcast(T key) { return _mm512_set1_epi64(key); }
+    static Reg min(Reg a, Reg b) { return _mm512_min_epi64(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm512_max_epi64(a, b); }
+    static unsigned lessMask(Reg v, Reg pivot) {
+        return _mm512_cmplt_epi64_mask(v, pivot);
+    }
+    static unsigned lessEqualMask(Reg v, Reg pivot) {
+        return _mm512_cmple_epi64_mask(v, pivot);
+    }
+    static Reg permuteXor(Reg v, int j) {
+        return _mm512_permutexvar_epi64(xorIndices64(j), v);
+    }
+    static Reg blend(Reg a, Reg b, unsigned bits) {
+        return _mm512_mask_blend_epi64(bits, a, b);
+    }
+    static void storePartitioned(T *left, T *right, Reg v, unsigned bits,
+                                 int count) {
+        _mm512_mask_compressstoreu_epi64(left, bits, v);
+        _mm512_mask_compressstoreu_epi64(right - (Lanes - count), ~bits, v);
+    }
+};
+
+struct Float {
+    using T = float;
+    using Reg = __m512;
+    static constexpr int Lanes = 16;
+    static constexpr int NetworkRegisters = 4;
+
+    static T padding() { return __builtin_inff(); }
+    static Reg load(const T *p) { return _mm512_loadu_ps(p); }
+    static void store(T *p, Reg v) { _mm512_storeu_ps(p, v); }
+    static Reg broadcast(T key) { return _mm512_set1_ps(key); }
+    static Reg min(Reg a, Reg b) { return _mm512_min_ps(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm512_max_ps(a, b); }
+    static unsigned lessMask(Reg v, Reg pivot) {
+        return _mm512_cmp_ps_mask(v, pivot, _CMP_LT_OQ);
+    }
+    static unsigned lessEqualMask(Reg v, Reg pivot) {
+        return _mm512_cmp_ps_mask(v, pivot, _CMP_LE_OQ);
+    }
+    static Reg permuteXor(Reg v, int j) {
+        return _mm512_permutexvar_ps(xorIndices32(j), v);
+    }
+    static Reg blend(Reg a, Reg b, unsigned bits) {
+        return _mm512_mask_blend_ps(bits, a, b);
+    }
+    static void storePartitioned(T *left, T *right, Reg v, unsigned bits,
+                                 int count) {
+        _mm512_mask_compressstoreu_ps(left, bits, v);
+        _mm512_mask_compressstoreu_ps(right - (Lanes - count), ~bits, v);
+    }
+};
+
+} // namespace
+
+void vectorSortAvx512(std::int32_t *keys, std::size_t size) {
+    QuickSortKernel<Int32>::sort(keys, size);
+}
+
+void vectorSortAvx512(std::int64_t *keys, std::size_t size) {
+    QuickSortKernel<Int64>::sort(keys, size);
+}
+
+void vectorSortAvx512(float *keys, std::size_t size) {
+    QuickSortKernel<Float>::sort(keys, size);
+}
@@ -0,0 +1,279 @@
+/* -*- mode: c++; -*- */
+#ifndef VECTORSORTIMPL_H
+#define VECTORSORTIMPL_H
+
+// The quicksort of vectorSort(), shared by its kernels, which are
+// compiled for their instruction sets in their own translation units.
+// Code they instantiate must have internal linkage, or the linker may
+// pick their copy, with instructions the CPU may lack, for the whole
+// program.  Hence nothing here is instantiated but with the vector
+// types of the kernels, which live in anonymous namespaces, and the
+// kernels take pointers rather than spans.
+
+#include <cstddef>
+#include <cstdint>
+
+// Heapsort, for when partitions are too uneven.  Defined for the key
+// types and SortItem in VectorSort.cpp.
+template <typename T> void vectorSortFallback(T *keys, std::size_t size);
+
+void vectorSortAvx2(std::int32_t *keys, std::size_t size);
+void vectorSortAvx2(std::int64_t *keys, std::size_t size);
+void vectorSortAvx2(float *keys, std::size_t size);
+void vectorSortAvx512(std::int32_t *keys, std::size_t size);
+void vectorSortAvx512(std::int64_t *keys, std::size_t size);
+void vectorSortAvx512(float *keys, std::size_t size);
+
+// A bitonic sorting network of V::NetworkRegisters registers of
+// V::Lanes keys.  Stage s compares keys j apart, in blocks of k keys
+// which alternately end up ascending and descending.
+template <typename V> struct BitonicNetwork {
+    static constexpr int Registers = V::NetworkRegisters;
+    static constexpr int Size = Registers * V::Lanes;
+
+    static constexpr int stageCount() {
+        int count = 0;
+        for (int k = 2; k <= Size; k *= 2) {
+            for (int j = k / 2; j > 0; j /= 2) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    struct Stage {
+        int k = 0;
+        int j = 0;
+        // For stages within registers: lanes which get the larger key
+        // of their pair.
+        unsigned takeMax[Registers] = {};
+    };
+    struct Stages {
+        Stage stages[stageCount()];
+    };
+
+    static constexpr Stages make() {
+        Stages result;
+        int s = 0;
+        for (int k = 2; k <= Size; k *= 2) {
+            for (int j = k / 2; j > 0; j /= 2, s++) {
+                auto &stage = result.stages[s];
+                stage.k = k;
+                stage.j = j;
+                for (int r = 0; r < Registers; r++) {
+                    for (int lane = 0; lane < V::Lanes; lane++) {
+                        const int i = r * V::Lanes + lane;
+                        if (((i & j) == 0) != ((i & k) == 0)) {
+                            stage.takeMax[r] |= 1u << lane;
+                        }
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    static constexpr Stages network = make();
+};
+
+// Quicksort over a vector type V, which has:
+// - T, the key type, Reg, a register of Lanes keys, and
+//   NetworkRegisters, the registers small ranges are sorted in,
+// - padding(), a key no smaller than any other,
+// - load(), store(), broadcast(), min() and max() of registers,
+// - lessMask() and lessEqualMask(), the bits of the lanes of a register
+//   less than (or equal to) those of another,
+// - permuteXor(v, j), whose lane i is lane i ^ j of v, for j < Lanes,
+// - blend(a, b, bits), the lanes of b whose bits are set, else of a,
+// - storePartitioned(left, right, v, bits, count), which stores the
+//   count lanes of v whose bits are set from left on and the others
+//   back from right.  It may write any of Lanes keys from left and back
+//   from right.
+template <typename V> class QuickSortKernel {
+  public:
+    using T = typename V::T;
+    using Reg = typename V::Reg;
+
+    static void sort(T *keys, std::size_t size) {
+        // Introsort's limit.
+        int depth = 0;
+        for (std::size_t n = size; n > 1; n /= 2) {
+            depth += 2;
+        }
+        sortRange(keys, keys + size, depth);
+    }
+
+  private:
+    using Network = BitonicNetwork<V>;
+    static constexpr std::ptrdiff_t Lanes = V::Lanes;
+
+    static void sortRange(T *first, T *last, int depth) {
+        while (last - first > Network::Size) {
+            if (depth-- == 0) {
+                vectorSortFallback(first, last - first);
+                return;
+            }
+
+            const T pivot = choosePivot(first, last);
+            T *middle = partition<false>(first, last, pivot);
+            if (middle == first) {
+                // The pivot is the smallest key, and keys equal to it
+                // are where they belong.
+                first = partition<true>(first, last, pivot);
+                continue;
+            }
+
+            // Recurses into the smaller part, so that the stack stays
+            // logarithmic.
+            if (middle - first < last - middle) {
+                sortRange(first, middle, depth);
+                first = middle;
+            } else {
+                sortRange(middle, last, depth);
+                last = middle;
+            }
+        }
+        sortSmall(first, last);
+    }
+
+    // The median of keys spread over the range, of which there are
+    // more than fit the network.
+    static T choosePivot(const T *first, const T *last) {
+        T sample[Network::Size];
+        const auto step = (last - first) / Network::Size;
+        for (int i = 0; i < Network::Size; i++) {
+            sample[i] = first[i * step];
+        }
+        sortNetwork(sample);
+        return sample[Network::Size / 2];
+    }
+
+    static void sortSmall(T *first, T *last) {
+        T keys[Network::Size];
+        const int size = last - first;
+        for (int i = 0; i < size; i++) {
+            keys[i] = first[i];
+        }
+        for (int i = size; i < Network::Size; i++) {
+            keys[i] = V::padding();
+        }
+        sortNetwork(keys);
+        for (int i = 0; i < size; i++) {
+            first[i] = keys[i];
+        }
+    }
+
+    static void sortNetwork(T *keys) {
+        Reg regs[Network::Registers];
+        for (int r = 0; r < Network::Registers; r++) {
+            regs[r] = V::load(keys + r * Lanes);
+        }
+
+        for (const auto &stage : Network::network.stages) {
+            if (stage.j < Lanes) {
+                for (int r = 0; r < Network::Registers; r++) {
+                    const Reg pairs = V::permuteXor(regs[r], stage.j);
+                    regs[r] = V::blend(V::min(regs[r], pairs),
+                                       V::max(regs[r], pairs),
+                                       stage.takeMax[r]);
+                }
+                continue;
+            }
+
+            const int distance = stage.j / Lanes;
+            for (int a = 0; a < Network::Registers; a++) {
+                const int b = a ^ distance;
+                if (b < a) {
+                    continue;
+                }
+                const Reg lo = V::min(regs[a], regs[b]);
+                const Reg hi = V::max(regs[a], regs[b]);
+                const bool ascending = ((a * Lanes) & stage.k) == 0;
+                regs[a] = ascending ? lo : hi;
+                regs[b] = ascending ? hi : lo;
+            }
+        }
+
+        for (int r = 0; r < Network::Registers; r++) {
+            V::store(keys + r * Lanes, regs[r]);
+        }
+    }
+
+    template <bool OrEqual> static bool goesLeft(const T &key, const T &pivot) {
+        return OrEqual ? !(pivot < key) : key < pivot;
+    }
+
+    template <bool OrEqual>
+    static unsigned goesLeftMask(const Reg &v, const Reg &pivot) {
+        return OrEqual ? V::lessEqualMask(v, pivot) : V::lessMask(v, pivot);
+    }
+
+    // Without branches, which masks of random keys would mispredict.
+    static int countBits(std::uint32_t bits) {
+        bits = bits - ((bits >> 1) & 0x55555555);
+        bits = (bits & 0x33333333) + ((bits >> 2) & 0x33333333);
+        return (((bits + (bits >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+    }
+
+    // Moves the keys less than (or equal to) the pivot to the front,
+    // and returns the end of them.
+    //
+    // The first and the last vector are held in registers, which frees
+    // their space.  Each vector read is then stored partitioned to the
+    // front and the back, into the free space, and read from the side
+    // with less of it, so that both sides keep at least a vector of it
+    // for storePartitioned().  Once all are read, the free space is the
+    // 2 vectors between the partitions, which the held vectors fill.
+    template <bool OrEqual>
+    static T *partition(T *first, T *last, const T &pivot) {
+        // Shortens the range to whole vectors.
+        for (auto rest = (last - first) % Lanes; rest > 0; rest--) {
+            if (goesLeft<OrEqual>(*first, pivot)) {
+                first++;
+            } else {
+                const T key = *first;
+                *first = *--last;
+                *last = key;
+            }
+        }
+        if (first == last) {
+            return first;
+        }
+
+        const Reg pivots = V::broadcast(pivot);
+        T *writeLeft = first;
+        T *writeRight = last;
+        const auto store = [&](const Reg &v) {
+            const unsigned bits = goesLeftMask<OrEqual>(v, pivots);
+            const int count = countBits(bits);
+            V::storePartitioned(writeLeft, writeRight, v, bits, count);
+            writeLeft += count;
+            writeRight -= Lanes - count;
+        };
+
+        if (last - first == Lanes) {
+            store(V::load(first));
+            return writeLeft;
+        }
+
+        const Reg firstVector = V::load(first);
+        const Reg lastVector = V::load(last - Lanes);
+        T *readLeft = first + Lanes;
+        T *readRight = last - Lanes;
+        while (readLeft != readRight) {
+            if (readLeft - writeLeft <= writeRight - readRight) {
+                const Reg v = V::load(readLeft);
+                readLeft += Lanes;
+                store(v);
+            } else {
+                readRight -= Lanes;
+                store(V::load(readRight));
+            }
+        }
+        store(firstVector);
+        store(lastVector);
+        return writeLeft;
+    }
+};
+
+#endif
@@ -0,0 +1,493 @@
+#include "Verify.h"
+#include "Affinity.h"
+#include "Algorithms.h"
+#include "SortItem.h"
+#include "VectorSort.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <csignal>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+
+// Sizes where algorithms switch strategies or index arithmetic goes
+// wrong, tested with every order.
+static constexpr int EdgeSizes[] = {0,  1,  2,  3,  4,  5,   7,   8,
+                                    15, 16, 17, 31, 32, 33,  63,  64,
+                                    65, 99, 100, 127, 128, 129, 1000};
+
+struct VerifyOptions {
+    QString algorithmPattern;
+    AlgorithmFilter filter;
+    // Explicit sizes and orders, or empty to generate cases.
+    QVector<int> sizes;
+    QVector<ArrayOrder> orders;
+    std::optional<SelectionK> selectK;
+    int maxSize = 0;
+    int fuzzCases = 0;
+    int jobs = 0;
+    bool allSizes = false;
+    std::uint64_t seed = 0;
+    std::optional<std::uint64_t> swaps;
+};
+
+struct VerifyCase {
+    const Algorithm *algorithm = nullptr;
+    ArrayOrder order = ArrayOrder::Random;
+    int size = 0;
+    std::size_t k = 0;
+    std::uint64_t seed = 0;
+    std::optional<std::uint64_t> swaps;
+};
+
+void addVerifyOptions(QCommandLineParser &parser) {
+    parser.addOptions({
+        {"tests", "Verify all algorithms and exit"},
+        {"max-size", "Largest number of items --tests tries", "size",
+         "10000000"},
+        {"fuzz-cases",
+         "Cases of random size, order and k --tests tries per algorithm",
+         "count", "20"},
+        {"jobs",
+         "Cases --tests runs at once, one per CPU (of --cpus, if given) "
+         "if 0",
+         "count", "0"},
+    });
+}
+
+static std::optional<int> parseCount(const QCommandLineParser &parser,
+                                     const QString &name,
+                                     const char *description) {
+    bool ok;
+    const int value = parser.value(name).toInt(&ok);
+    if (!ok || value < 0) {
+        fprintf(stderr, "Invalid %s: %s\n", description,
+                qPrintable(parser.value(name)));
+        return std::nullopt;
+    }
+    return value;
+}
+
+static std::optional<VerifyOptions>
+parseOptions(const QCommandLineParser &parser) {
+    VerifyOptions options;
+    options.algorithmPattern = parser.value("algorithms");
+    options.filter.stableOnly = parser.isSet("stable");
+    options.filter.inPlaceOnly = parser.isSet("in-place");
+    options.filter.excludeParallel = parser.isSet("no-parallel");
+    options.allSizes = parser.isSet("all-sizes");
+
+    if (parser.isSet("sizes")) {
+        for (const auto &size : parser.value("sizes").split(',')) {
+            bool ok;
+            int value = size.toInt(&ok);
+            if (!ok || value < 0) {
+                fprintf(stderr, "Invalid size: %s\n", qPrintable(size));
+                return std::nullopt;
+            }
+            options.sizes.append(value);
+        }
+    }
+
+    if (parser.isSet("orders")) {
+        for (const auto &name : parser.value("orders").split(',')) {
+            const auto order = arrayOrderFromName(name);
+            if (!order) {
+                fprintf(stderr, "Invalid order: %s\n", qPrintable(name));
+                return std::nullopt;
+            }
+            options.orders.append(*order);
+        }
+    }
+
+    if (parser.isSet("select-k")) {
+        options.selectK = SelectionK::fromString(parser.value("select-k"));
+        if (!options.selectK) {
+            fprintf(stderr, "Invalid k: %s\n",
+                    qPrintable(parser.value("select-k")));
+            return std::nullopt;
+        }
+    }
+
+    const auto maxSize = parseCount(parser, "max-size", "size");
+    const auto fuzzCases = parseCount(parser, "fuzz-cases", "count");
+    const auto jobs = parseCount(parser, "jobs", "count");
+    if (!maxSize || !fuzzCases || !jobs) {
+        return std::nullopt;
+    }
+    options.maxSize = *maxSize;
+    options.fuzzCases = *fuzzCases;
+    options.jobs = *jobs;
+    if (!options.jobs) {
+        const auto &cpus = threadPlacement().cpus;
+        options.jobs = cpus.empty()
+                           ? std::max(1u, std::thread::hardware_concurrency())
+                           : cpus.size();
+    }
+
+    options.seed = randomSeed();
+    if (parser.isSet("seed")) {
+        bool ok;
+        options.seed = parser.value("seed").toULongLong(&ok);
+        if (!ok) {
+            fprintf(stderr, "Invalid seed: %s\n",
+                    qPrintable(parser.value("seed")));
+            return std::nullopt;
+        }
+    }
+    options.swaps = swapsOption(parser);
+
+    return options;
+}
+
+// Explicit sizes and orders are tested as given, with the given seed,
+// so that failures can be reproduced.  Otherwise, every algorithm is
+// tested on the edge sizes with every order and on random sizes up to
+// --max-size, with seeds drawn from the given one.
+static std::vector<VerifyCase> makeCases(const VerifyOptions &options) {
+    std::mt19937_64 random(options.seed);
+    std::vector<VerifyCase> cases;
+
+    QVector<ArrayOrder> orders = options.orders;
+    if (orders.isEmpty()) {
+        for (int i = 0; i < ArrayOrderCount; i++) {
+            orders.append(static_cast<ArrayOrder>(i));
+        }
+    }
+
+    for (const auto &algorithm : GetAlgorithms()) {
+        if (!algorithm.name.contains(options.algorithmPattern) ||
+            !options.filter.matches(algorithm)) {
+            continue;
+        }
+
+        const auto limit = options.allSizes ? std::size_t(options.maxSize)
+                                            : algorithm.maxRecommendedSize;
+        const auto maxSize = std::min<std::size_t>(options.maxSize, limit);
+
+        // Selection algorithms are tested with the smallest, the median
+        // and the largest k, or a random one.
+        auto add = [&](ArrayOrder order, int size, std::uint64_t seed,
+                       bool randomK) {
+            VerifyCase c{&algorithm, order, size, std::size_t(size), seed,
+                         options.swaps};
+            if (algorithm.selection == SelectionKind::None || size <= 1) {
+                cases.push_back(c);
+            } else if (options.selectK) {
+                c.k = options.selectK->forSize(size);
+                cases.push_back(c);
+            } else if (randomK) {
+                c.k = std::uniform_int_distribution<int>(1, size)(random);
+                cases.push_back(c);
+            } else {
+                for (int k : {1, (size + 1) / 2, size}) {
+                    c.k = k;
+                    cases.push_back(c);
+                }
+            }
+        };
+
+        if (!options.sizes.isEmpty()) {
+            for (auto order : orders) {
+                for (int size : options.sizes) {
+                    if (std::size_t(size) <= limit) {
+                        add(order, size, options.seed, false);
+                    }
+                }
+            }
+            continue;
+        }
+
+        for (auto order : orders) {
+            for (int size : EdgeSizes) {
+                if (std::size_t(size) <= maxSize) {
+                    add(order, size, random(), false);
+                }
+            }
+        }
+
+        // Log-uniform, so that small sizes are as likely as large ones.
+        // Sizes are one less than exp() rounded down, which is below
+        // maxSize + 2, so that both 0 and maxSize are drawn.
+        const double maxLogSize = std::log(maxSize + 2.0);
+        std::uniform_real_distribution<double> logSize(0, maxLogSize);
+        std::uniform_int_distribution<int> order(0, int(orders.size()) - 1);
+        for (int i = 0; i < options.fuzzCases; i++) {
+            const int size = static_cast<int>(std::min<double>(
+                maxSize, std::floor(std::exp(logSize(random))) - 1));
+            add(orders[order(random)], size, random(), true);
+        }
+    }
+
+    return cases;
+}
+
+// The finalizer of SplitMix64.
+static std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111eb;
+    x ^= x >> 31;
+    return x;
+}
+
+// Sums of hashes, which don't depend on the order of the items, of the
+// values and of the values with their tags.  The hashes are salted, so
+// that zeros count.
+struct Fingerprint {
+    std::uint64_t values = 0;
+    std::uint64_t items = 0;
+};
+
+static Fingerprint fingerprint(const std::vector<SortItem> &items) {
+    Fingerprint result;
+    for (const auto &item : items) {
+        const std::uint32_t value = item.value();
+        result.values += mix(value + 0x9e3779b97f4a7c15);
+        result.items +=
+            mix((std::uint64_t(value) << 32 | item.tag()) ^ 0xd1b54a32d192ed03);
+    }
+    return result;
+}
+
+// Whether the kernel sorts the values of the items like std::sort.
+template <typename Key>
+static bool kernelSorts(const std::function<void(std::span<Key>)> &sort,
+                        const std::vector<SortItem> &items) {
+    std::vector<Key> keys;
+    for (const auto &item : items) {
+        keys.push_back(Key(item.value()));
+    }
+    auto expected = keys;
+    std::sort(expected.begin(), expected.end());
+    sort(keys);
+    return keys == expected;
+}
+
+// Returns which kernel for plain keys failed the case, if any.
+static QString verifyKernels(const Algorithm &algorithm,
+                             const std::vector<SortItem> &items) {
+    if (algorithm.sortInt32 && !kernelSorts(algorithm.sortInt32, items)) {
+        return "int32 kernel didn't sort like std::sort";
+    }
+    if (algorithm.sortInt64 && !kernelSorts(algorithm.sortInt64, items)) {
+        return "int64 kernel didn't sort like std::sort";
+    }
+    if (algorithm.sortFloat && !kernelSorts(algorithm.sortFloat, items)) {
+        return "float kernel didn't sort like std::sort";
+    }
+    return {};
+}
+
+// Checked one case at a time, since the vector target is process-wide.
+static std::mutex vectorTargetMutex;
+
+// Verifies the kernels on every vector target up to the CPU's, so that
+// each compiled kernel is checked.
+static QString verifyKernels(const VerifyCase &c) {
+    const auto &algorithm = *c.algorithm;
+    if (algorithm.selection != SelectionKind::None) {
+        return {};
+    }
+    const auto items = generateVector(c.size, c.order, c.seed, c.swaps);
+
+    std::lock_guard lock(vectorTargetMutex);
+    const auto maxTarget = vectorTarget();
+    QString error;
+    for (int i = 0; i <= int(maxTarget) && error.isEmpty(); i++) {
+        const auto target = static_cast<VectorTarget>(i);
+        setMaxVectorTarget(target);
+        error = verifyKernels(algorithm, items);
+        if (!error.isEmpty()) {
+            error += QString(" on %1").arg(vectorTargetName(target));
+        }
+    }
+    setMaxVectorTarget(maxTarget);
+    return error;
+}
+
+// Returns why the algorithm failed the case, or an empty string.
+static QString verify(const VerifyCase &c) {
+    const auto &algorithm = *c.algorithm;
+    auto items = generateVector(c.size, c.order, c.seed, c.swaps);
+    for (std::size_t i = 0; i < items.size(); i++) {
+        items[i].setTag(i);
+    }
+    const auto before = fingerprint(items);
+
+    try {
+        algorithm.run(items, c.k);
+    } catch (const std::exception &e) {
+        return QString("Threw %1").arg(e.what());
+    }
+
+    if (!algorithm.isDone(items, c.k)) {
+        if (algorithm.selection != SelectionKind::None) {
+            return "Didn't select the k smallest items";
+        }
+        const auto unsorted = std::is_sorted_until(items.begin(), items.end());
+        return QString("Not sorted at index %1")
+            .arg(unsorted - items.begin());
+    }
+
+    const auto after = fingerprint(items);
+    if (after.values != before.values) {
+        return "Items changed, not only their order";
+    }
+
+    if (const auto error = verifyKernels(c); !error.isEmpty()) {
+        return error;
+    }
+
+    if (!algorithm.stable || algorithm.selection != SelectionKind::None) {
+        return {};
+    }
+    // Tags only move with their values when items are moved, not when
+    // values are written, e.g. through the plugin interface.
+    if (after.items != before.items) {
+        return "Items were overwritten with values, so stability can't be "
+               "verified";
+    }
+    for (std::size_t i = 1; i < items.size(); i++) {
+        if (items[i - 1].value() == items[i].value() &&
+            items[i - 1].tag() > items[i].tag()) {
+            return QString("Not stable at index %1").arg(i);
+        }
+    }
+    return {};
+}
+
+static QString reproduction(const VerifyCase &c) {
+    auto command = QString("sort --tests --algorithms '%1' --orders %2 "
+                           "--sizes %3 --seed %4")
+                       .arg(c.algorithm->name)
+                       .arg(arrayOrderName(c.order))
+                       .arg(c.size)
+                       .arg(c.seed);
+    if (c.algorithm->selection != SelectionKind::None) {
+        command += QString(" --select-k %1").arg(c.k);
+    }
+    if (c.swaps) {
+        command += QString(" --swaps %1").arg(*c.swaps);
+    }
+    return command;
+}
+
+static void printFailure(const VerifyCase &c, const QString &error) {
+    fprintf(stderr, "FAILED: %s, %s, %d items", qPrintable(c.algorithm->name),
+            qPrintable(arrayOrderName(c.order)), c.size);
+    if (c.algorithm->selection != SelectionKind::None) {
+        fprintf(stderr, ", k = %zu", c.k);
+    }
+    fprintf(stderr, ": %s\n  Reproduce with: %s\n", qPrintable(error),
+            qPrintable(reproduction(c)));
+}
+
+// The reproduction of the case the thread runs, for reporting crashes,
+// e.g. failed assertions, which take down all threads.
+static thread_local std::string CurrentReproduction;
+
+static void reportCrash(int signal) {
+    if (!CurrentReproduction.empty()) {
+        fprintf(stderr, "Crashed, reproduce with: %s\n",
+                CurrentReproduction.c_str());
+    }
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+int RunTests(const QCommandLineParser &parser) {
+    const auto options = parseOptions(parser);
+    if (!options) {
+        return EXIT_FAILURE;
+    }
+
+    const auto cases = makeCases(*options);
+
+    // Largest cases first, so that no thread is left with a large case
+    // at the end.
+    std::vector<std::size_t> schedule(cases.size());
+    std::iota(schedule.begin(), schedule.end(), 0);
+    std::stable_sort(schedule.begin(), schedule.end(),
+                     [&](std::size_t lhs, std::size_t rhs) {
+                         return cases[lhs].size > cases[rhs].size;
+                     });
+
+    // Passing them with --seed and --swaps tries the same cases again.
+    printf("seed: %llu\n", (unsigned long long)options->seed);
+    if (options->swaps) {
+        printf("swaps: %llu\n", (unsigned long long)*options->swaps);
+    }
+    printf("Verifying %zu cases on %d threads (%s)...\n", cases.size(),
+           options->jobs, qPrintable(threadPlacement().toString()));
+    fflush(stdout);
+
+    for (int signal : {SIGABRT, SIGFPE, SIGILL, SIGSEGV}) {
+        std::signal(signal, reportCrash);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<bool> failed(cases.size());
+    std::atomic<std::size_t> next = 0;
+    std::mutex mutex;
+    const auto &placement = threadPlacement();
+    auto work = [&](int worker) {
+        if (placement.pinWorkers) {
+            const auto &cpus = placement.cpus;
+            const auto error = pinCurrentThread(cpus[worker % cpus.size()]);
+            if (!error.isEmpty()) {
+                std::lock_guard lock(mutex);
+                fprintf(stderr, "%s\n", qPrintable(error));
+            }
+        }
+        for (std::size_t i; (i = next++) < schedule.size();) {
+            const auto &c = cases[schedule[i]];
+            CurrentReproduction = reproduction(c).toStdString();
+            const auto error = verify(c);
+            if (!error.isEmpty()) {
+                std::lock_guard lock(mutex);
+                failed[schedule[i]] = true;
+                printFailure(c, error);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < options->jobs; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    int failures = 0;
+    for (std::size_t begin = 0, end; begin < cases.size(); begin = end) {
+        int algorithmFailures = 0;
+        for (end = begin; end < cases.size() &&
+                          cases[end].algorithm == cases[begin].algorithm;
+             end++) {
+            algorithmFailures += failed[end];
+        }
+        printf("%-36s %6zu cases  ",
+               cases[begin].algorithm->name.toStdString().c_str(),
+               end - begin);
+        if (algorithmFailures) {
+            printf("%d FAILED\n", algorithmFailures);
+        } else {
+            printf("ok\n");
+        }
+        failures += algorithmFailures;
+    }
+
+    printf("%d of %zu cases failed in %.1f s\n", failures, cases.size(),
+           timer.elapsed() / 1000.0);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
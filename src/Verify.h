@@ -0,0 +1,15 @@
+/* -*- mode: c++; -*- */
+#ifndef VERIFY_H
+#define VERIFY_H
+
+class QCommandLineParser;
+
+// Verification of all algorithms, run with --tests: checks that they
+// order the items, keep their multiset and, if they claim to be
+// stable, the order of equal items, on edge case and random sizes and
+// on every order, in parallel.  Failures are reported with the options
+// reproducing them.
+void addVerifyOptions(QCommandLineParser &);
+int RunTests(const QCommandLineParser &);
+
+#endif
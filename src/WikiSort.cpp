@@ -15,8 +15,12 @@
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <optional>
+#include <type_traits>
 #include <vector>
 
+#include "WikiSort.h"
+
 // record the number of comparisons and assignments
 // note that this reduces WikiSort's performance when enabled
 #define PROFILE false
@@ -25,15 +29,10 @@
 // (this also reduces performance slightly)
 #define VERIFY false
 
-// simulate comparisons that have a bit more overhead than just an inlined (int < int)
-// (so we can tell whether reducing the number of comparisons was worth the added complexity)
-#define SLOW_COMPARISONS false
-
 // if true, test against std::__inplace_stable_sort() rather than std::stable_sort()
 #define TEST_INPLACE false
 
-// whether to give WikiSort a full-size cache, to see how it performs when given more memory
-#define DYNAMIC_CACHE true
+// the size of WikiSort's cache is chosen at runtime, see Wiki::CachePolicy
 
 
 double Seconds() { return std::clock() * 1.0/CLOCKS_PER_SEC; }
@@ -194,7 +193,7 @@ namespace Wiki {
         }
 
         // copy the remainder of A into the final array
-        std::copy(A_index, A_last, insert_index);
+        copyItems(A_index, A_last, insert_index);
     }
 
     // merge operation using an internal buffer
@@ -227,7 +226,7 @@ namespace Wiki {
         }
 
         // BlockSwap
-        std::swap_ranges(A_index, A_last, insert_index);
+        swapItemRanges(A_index, A_last, insert_index);
     }
 
     // merge operation without a buffer
@@ -263,7 +262,7 @@ namespace Wiki {
 
             // rotate A into place
             std::size_t amount = mid - last1;
-            std::rotate(first1, last1, mid);
+            rotateItems(first1, last1, mid);
             if (last2 == mid) break;
 
             // calculate the new A and B ranges
@@ -333,48 +332,65 @@ namespace Wiki {
         }
     };
 
-#if DYNAMIC_CACHE
     // use a class so the memory for the cache is freed when the object goes out of scope,
     // regardless of whether exceptions were thrown (only needed in the C++ version)
     template <typename T>
     class Cache {
     public:
-        T *cache;
-        std::size_t cache_size;
+        T *cache = nullptr;
+        std::size_t cache_size = 0;
+        // shows the cache as an auxiliary buffer of the visualized run
+        std::optional<AuxBuffer> aux_buffer;
 
         ~Cache() {
-            if (cache) delete[] cache;
+            aux_buffer.reset();
+            delete[] cache;
         }
 
-        Cache(std::size_t size) {
+        Cache(std::size_t size, const CachePolicy &policy) {
             // good choices for the cache size are:
             // (size + 1)/2 – turns into a full-speed standard merge sort since everything fits into the cache
-            cache_size = (size + 1)/2;
-            cache = new (std::nothrow) T[cache_size];
-            if (cache) return;
-
-            // sqrt((size + 1)/2) + 1 – this will be the size of the A blocks at the largest level of merges,
-            // so a buffer of this size would allow it to skip using internal or in-place merges for anything
-            cache_size = std::sqrt(cache_size) + 1;
-            cache = new (std::nothrow) T[cache_size];
-            if (cache) return;
-
-            // 512 – chosen from careful testing as a good balance between fixed-size memory use and run time
-            if (cache_size > 512) {
+            const std::size_t half = (size + 1)/2;
+
+            switch (policy.kind) {
+            case CacheKind::None:
+                cache_size = 0;
+                break;
+            case CacheKind::Fixed:
+                // 512 – chosen from careful testing as a good balance between fixed-size memory use and run time
                 cache_size = 512;
-                cache = new (std::nothrow) T[cache_size];
-                if (cache) return;
+                break;
+            case CacheKind::SquareRoot:
+                // sqrt((size + 1)/2) + 1 – this will be the size of the A blocks at the largest level of merges,
+                // so a buffer of this size would allow it to skip using internal or in-place merges for anything
+                cache_size = std::sqrt(half) + 1;
+                break;
+            case CacheKind::Half:
+                cache_size = half;
+                break;
+            case CacheKind::Budget:
+                cache_size = policy.budgetBytes / sizeof(T);
+                break;
             }
 
+            // anything beyond half the array is never used
+            cache_size = std::min(cache_size, half);
+            if (cache_size == 0) return;
+
             // 0 – if the system simply cannot allocate any extra memory whatsoever, no memory works just fine
-            cache_size = 0;
+            cache = new (std::nothrow) T[cache_size];
+            if (!cache) cache_size = 0;
+
+            if constexpr (std::is_same_v<T, SortItem>) {
+                if (cache) aux_buffer.emplace(std::span<const T>(cache, cache_size));
+            }
         }
     };
-#endif
 
     // bottom-up merge sort combined with an in-place merge algorithm for O(1) memory use
     template <typename RandomAccessIterator, typename Comparison>
-    void Sort(RandomAccessIterator first, RandomAccessIterator last, Comparison compare) {
+    void Sort(RandomAccessIterator first, RandomAccessIterator last, Comparison compare,
+              const CachePolicy &policy) {
         // map first and last to a C-style array, so we don't have to change the rest of the code
         // (bit of a nasty hack, but it's good enough for now...)
         typedef typename std::iterator_traits<RandomAccessIterator>::value_type T;
@@ -462,18 +478,9 @@ namespace Wiki {
         if (size < 8) return;
 
         // use a small cache to speed up some of the operations
-        #if DYNAMIC_CACHE
-            Cache<T> cache_obj (size);
-            T *cache = cache_obj.cache;
-            const std::size_t cache_size = cache_obj.cache_size;
-        #else
-            // since the cache size is fixed, it's still O(1) memory!
-            // just keep in mind that making it too small ruins the point (nothing will fit into it),
-            // and making it too large also ruins the point (so much for "low memory"!)
-            // removing the cache entirely still gives 75% of the performance of a standard merge
-            const std::size_t cache_size = 512;
-            T cache[cache_size];
-        #endif
+        Cache<T> cache_obj (size, policy);
+        T *cache = cache_obj.cache;
+        const std::size_t cache_size = cache_obj.cache_size;
 
         // then merge sort the higher levels, which can be 8-15, 16-31, 32-63, 64-127, etc.
         while (true) {
@@ -494,8 +501,8 @@ namespace Wiki {
 
                         if (compare(*(B1.end - 1), *A1.start)) {
                             // the two ranges are in reverse order, so copy them in reverse order into the cache
-                            std::copy(A1.start, A1.end, cache + B1.length());
-                            std::copy(B1.start, B1.end, cache);
+                            copyItems(A1.start, A1.end, cache + B1.length());
+                            copyItems(B1.start, B1.end, cache);
                         } else if (compare(*B1.start, *(A1.end - 1))) {
                             // these two ranges weren't already in order, so merge them into the cache
                             std::merge(A1.start, A1.end, B1.start, B1.end, cache, compare);
@@ -505,21 +512,21 @@ namespace Wiki {
                                 !compare(*A2.start, *(B1.end - 1))) continue;
 
                             // copy A1 and B1 into the cache in the same order at once
-                            std::copy(A1.start, B1.end, cache);
+                            copyItems(A1.start, B1.end, cache);
                         }
                         A1 = Range<RandomAccessIterator>(A1.start, B1.end);
 
                         // merge A2 and B2 into the cache
                         if (compare(*(B2.end - 1), *A2.start)) {
                             // the two ranges are in reverse order, so copy them in reverse order into the cache
-                            std::copy(A2.start, A2.end, cache + A1.length() + B2.length());
-                            std::copy(B2.start, B2.end, cache + A1.length());
+                            copyItems(A2.start, A2.end, cache + A1.length() + B2.length());
+                            copyItems(B2.start, B2.end, cache + A1.length());
                         } else if (compare(*B2.start, *(A2.end - 1))) {
                             // these two ranges weren't already in order, so merge them into the cache
                             std::merge(A2.start, A2.end, B2.start, B2.end, cache + A1.length(), compare);
                         } else {
                             // copy A2 and B2 into the cache in the same order at once
-                            std::copy(A2.start, B2.end, cache + A1.length());
+                            copyItems(A2.start, B2.end, cache + A1.length());
                         }
                         A2 = Range<RandomAccessIterator>(A2.start, B2.end);
 
@@ -529,14 +536,14 @@ namespace Wiki {
 
                         if (compare(*(B3.end - 1), *A3.start)) {
                             // the two ranges are in reverse order, so copy them in reverse order into the array
-                            std::copy(A3.start, A3.end, A1.start + A2.length());
-                            std::copy(B3.start, B3.end, A1.start);
+                            copyItems(A3.start, A3.end, A1.start + A2.length());
+                            copyItems(B3.start, B3.end, A1.start);
                         } else if (compare(*B3.start, *(A3.end - 1))) {
                             // these two ranges weren't already in order, so merge them back into the array
                             std::merge(A3.start, A3.end, B3.start, B3.end, A1.start, compare);
                         } else {
                             // copy A3 and B3 into the array in the same order at once
-                            std::copy(A3.start, B3.end, A1.start);
+                            copyItems(A3.start, B3.end, A1.start);
                         }
                     }
 
@@ -552,10 +559,10 @@ namespace Wiki {
 
                         if (compare(*(B.end - 1), *A.start)) {
                             // the two ranges are in reverse order, so a simple rotation should fix it
-                            std::rotate(A.start, A.end, B.end);
+                            rotateItems(A.start, A.end, B.end);
                         } else if (compare(*B.start, *(A.end - 1))) {
                             // these two ranges weren't already in order, so we'll need to merge them!
-                            std::copy(A.start, A.end, cache);
+                            copyItems(A.start, A.end, cache);
                             MergeExternal(A.start, A.end, B.start, B.end, cache, compare);
                         }
                     }
@@ -733,7 +740,7 @@ namespace Wiki {
                             index = FindFirstBackward(pull[pull_index].to, pull[pull_index].from - (count - 1),
                                                       *(index - 1), compare, length - count);
                             Range<RandomAccessIterator> range(index + 1, pull[pull_index].from + 1);
-                            std::rotate(range.start, range.end - count, range.end);
+                            rotateItems(range.start, range.end - count, range.end);
                             pull[pull_index].from = index + count;
                         }
                     } else if (pull[pull_index].to > pull[pull_index].from) {
@@ -743,7 +750,7 @@ namespace Wiki {
                             index = FindLastForward(index, pull[pull_index].to, *index,
                                                     compare, length - count);
                             Range<RandomAccessIterator> range(pull[pull_index].from, index - 1);
-                            std::rotate(range.start, range.start + count, range.end);
+                            rotateItems(range.start, range.start + count, range.end);
                             pull[pull_index].from = index - count - 1;
                         }
                     }
@@ -790,7 +797,7 @@ namespace Wiki {
 
                     if (compare(*(B.end - 1), *A.start)) {
                         // the two ranges are in reverse order, so a simple rotation should fix it
-                        std::rotate(A.start, A.end, B.end);
+                        rotateItems(A.start, A.end, B.end);
                     } else if (compare(*A.end, *(A.end - 1))) {
                         // these two ranges weren't already in order, so we'll need to merge them!
 
@@ -816,9 +823,9 @@ namespace Wiki {
                         // if the first unevenly sized A block fits into the cache, copy it there for when we go to Merge it
                         // otherwise, if the second buffer is available, block swap the contents into that
                         if (lastA.length() <= cache_size) {
-                            std::copy(lastA.start, lastA.end, cache);
+                            copyItems(lastA.start, lastA.end, cache);
                         } else if (buffer2.length() > 0) {
-                            std::swap_ranges(lastA.start, lastA.end, buffer2.start);
+                            swapItemRanges(lastA.start, lastA.end, buffer2.start);
                         }
 
                         if (blockA.length() > 0) {
@@ -838,7 +845,7 @@ namespace Wiki {
                                             minA = findA;
                                         }
                                     }
-                                    std::swap_ranges(blockA.start, blockA.start + block_size, minA);
+                                    swapItemRanges(blockA.start, blockA.start + block_size, minA);
 
                                     // swap the first item of the previous A block back with its original value, which is stored in buffer1
                                     std::iter_swap(blockA.start, indexA);
@@ -859,18 +866,18 @@ namespace Wiki {
                                     if (buffer2.length() > 0 || block_size <= cache_size) {
                                         // copy the previous A block into the cache or buffer2, since that's where we need it to be when we go to merge it anyway
                                         if (block_size <= cache_size) {
-                                            std::copy(blockA.start, blockA.start + block_size, cache);
+                                            copyItems(blockA.start, blockA.start + block_size, cache);
                                         } else {
-                                            std::swap_ranges(blockA.start, blockA.start + block_size, buffer2.start);
+                                            swapItemRanges(blockA.start, blockA.start + block_size, buffer2.start);
                                         }
 
                                         // this is equivalent to rotating, but faster
                                         // the area normally taken up by the A block is either the contents of buffer2, or data we don't need anymore since we memcopied it
                                         // either way we don't need to retain the order of those items, so instead of rotating we can just block swap B to where it belongs
-                                        std::swap_ranges(B_split, B_split + B_remaining, blockA.start + block_size - B_remaining);
+                                        swapItemRanges(B_split, B_split + B_remaining, blockA.start + block_size - B_remaining);
                                     } else {
                                         // we are unable to use the 'buffer2' trick to speed up the rotation operation since buffer2 doesn't exist, so perform a normal rotation
-                                        std::rotate(B_split, blockA.start, blockA.start + block_size);
+                                        rotateItems(B_split, blockA.start, blockA.start + block_size);
                                     }
 
                                     // update the range for the remaining A blocks, and the range remaining from the B block after it was split
@@ -883,7 +890,7 @@ namespace Wiki {
 
                                 } else if (blockB.length() < block_size) {
                                     // move the last B block, which is unevenly sized, to before the remaining A blocks, by using a rotation
-                                    std::rotate(blockA.start, blockB.start, blockB.end);
+                                    rotateItems(blockA.start, blockB.start, blockB.end);
 
                                     lastB = Range<RandomAccessIterator>(blockA.start, blockA.start + blockB.length());
                                     blockA.start += blockB.length();
@@ -891,7 +898,7 @@ namespace Wiki {
                                     blockB.end = blockB.start;
                                 } else {
                                     // roll the leftmost A block to the end by swapping it with the next B block
-                                    std::swap_ranges(blockA.start, blockA.start + block_size, blockB.start);
+                                    swapItemRanges(blockA.start, blockA.start + block_size, blockB.start);
                                     lastB = Range<RandomAccessIterator>(blockA.start, blockA.start + block_size);
 
                                     blockA.start += block_size;
@@ -937,7 +944,7 @@ namespace Wiki {
                             index = FindFirstForward(buffer.end, pull[pull_index].range.end,
                                                      *buffer.start, compare, unique);
                             std::size_t amount = index - buffer.end;
-                            std::rotate(buffer.start, buffer.end, index);
+                            rotateItems(buffer.start, buffer.end, index);
                             buffer.start += (amount + 1);
                             buffer.end += amount;
                             unique -= 2;
@@ -952,7 +959,7 @@ namespace Wiki {
                             index = FindLastBackward(pull[pull_index].range.start, buffer.start,
                                                      *(buffer.end - 1), compare, unique);
                             std::size_t amount = buffer.start - index;
-                            std::rotate(index, index + amount, buffer.end);
+                            rotateItems(index, index + amount, buffer.end);
                             buffer.start -= amount;
                             buffer.end -= (amount + 1);
                             unique -= 2;
@@ -967,11 +974,9 @@ namespace Wiki {
     }
 }
 
-#include "SortItem.h"
-
 namespace Wiki {
-void Sort(std::vector<SortItem>& vec) {
-    Sort(vec.begin(), vec.end(), std::less<>());
+void Sort(std::vector<SortItem>& vec, CachePolicy policy) {
+    Sort(vec.begin(), vec.end(), std::less<>(), policy);
 }
 }
 
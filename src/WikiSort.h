@@ -0,0 +1,31 @@
+/* -*- mode: c++; -*- */
+#ifndef WIKISORT_H
+#define WIKISORT_H
+
+#include "SortItem.h"
+#include <cstddef>
+#include <vector>
+
+namespace Wiki {
+
+enum class CacheKind {
+    None,
+    Fixed,
+    SquareRoot,
+    Half,
+    Budget,
+};
+
+// How much memory WikiSort may use for its external cache.  With no
+// cache (or a fixed-size one) it uses O(1) memory, with a half-size
+// cache it degenerates into a regular merge sort.
+struct CachePolicy {
+    CacheKind kind = CacheKind::Half;
+    std::size_t budgetBytes = 0;
+};
+
+void Sort(std::vector<SortItem> &vec, CachePolicy policy);
+
+} // namespace Wiki
+
+#endif
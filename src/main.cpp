@@ -1,26 +1,218 @@
+#include "Affinity.h"
 #include "Algorithms.h"
+#include "Auto.h"
+#include "BenchSuite.h"
+#include "Benchmark.h"
+#include "CacheSim.h"
+#include "Export.h"
+#include "FileSort.h"
 #include "MainWindow.h"
+#include "Measurement.h"
+#include "Plugins.h"
+#include "VectorSort.h"
+#include "Verify.h"
 #include <QApplication>
 #include <QCommandLineOption>
 #include <QCommandLineParser>
+#include <QScopedPointer>
+
+// Options of modes which run without a window, and therefore without
+// a display server.
+static const char *const HeadlessOptions[] = {
+    "tests", "benchmark", "bench-suite", "calibrate", "export", "sort",
+};
+
+// Looks for the options before they are parsed, as --name or
+// --name=value.
+static bool isHeadless(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (!qstrcmp(arg, "--")) {
+            break;
+        }
+        if (qstrncmp(arg, "--", 2)) {
+            continue;
+        }
+        arg += 2;
+        for (const char *option : HeadlessOptions) {
+            const auto length = qstrlen(option);
+            if (!qstrncmp(arg, option, length) &&
+                (arg[length] == '\0' || arg[length] == '=')) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static QCoreApplication *createApplication(int &argc, char *argv[]) {
+    if (isHeadless(argc, argv)) {
+        return new QCoreApplication(argc, argv);
+    }
+    return new QApplication(argc, argv);
+}
 
 int main(int argc, char *argv[]) {
-    QApplication app(argc, argv);
+    QScopedPointer<QCoreApplication> app(createApplication(argc, argv));
 
     QCommandLineParser parser;
     parser.addHelpOption();
-    QCommandLineOption runTests("tests", "Test all algorithms and exit");
-    parser.addOption(runTests);
+    QCommandLineOption pluginDir("plugin-dir",
+                                 "Load algorithm plugins from directory",
+                                 "directory", defaultPluginDirectory());
+    parser.addOption(pluginDir);
+    QCommandLineOption wikiCacheBudget(
+        "wiki-cache-budget",
+        "Also register WikiSort with a cache of at most this many bytes",
+        "bytes");
+    parser.addOption(wikiCacheBudget);
+    QCommandLineOption cacheLevels(
+        "cache-levels",
+        "Simulate this cache hierarchy, given as comma-separated "
+        "size[:ways[:line]] levels, e.g. 32K:8,1M:16,8M:16",
+        "levels");
+    parser.addOption(cacheLevels);
+    QCommandLineOption seed("seed",
+                            "Seed for generating the items to sort, random "
+                            "if not given",
+                            "seed");
+    parser.addOption(seed);
+    QCommandLineOption swaps("swaps",
+                             "Random swaps of SortedWithSwaps items, one "
+                             "per hundred items and one more if not given",
+                             "count");
+    parser.addOption(swaps);
+    parser.addOption({"select-k",
+                      "k for selection algorithms in --benchmark, --export "
+                      "and --tests: a number of items, or a percentage of "
+                      "them such as 10%",
+                      "k", "50%"});
+    QCommandLineOption autoTable(
+        "auto-table",
+        "Let the Auto algorithm pick algorithms from this table, as "
+        "printed by --calibrate",
+        "file");
+    parser.addOption(autoTable);
+    QCommandLineOption vectorTargetOption(
+        "vector-target",
+        "Highest instruction set VectorQuickSort uses: avx512, avx2 or "
+        "scalar",
+        "target", vectorTargetName(VectorTarget::Avx512));
+    parser.addOption(vectorTargetOption);
+    addAffinityOptions(parser);
+    addBenchmarkOptions(parser);
+    addBenchSuiteOptions(parser);
+    addExportOptions(parser);
+    addFileSortOptions(parser);
+    addMeasurementOptions(parser);
+    addVerifyOptions(parser);
+
+    parser.process(*app);
+
+    LoadPlugins(parser.value(pluginDir));
+
+    if (parser.isSet(wikiCacheBudget)) {
+        bool ok;
+        const auto bytes = parser.value(wikiCacheBudget).toULongLong(&ok);
+        if (!ok) {
+            fprintf(stderr, "Invalid cache budget: %s\n",
+                    qPrintable(parser.value(wikiCacheBudget)));
+            return EXIT_FAILURE;
+        }
+        RegisterAlgorithm(WikiSortWithBudget(bytes));
+    }
+
+    if (parser.isSet(autoTable)) {
+        QString error;
+        if (!loadAutoTable(parser.value(autoTable), &error)) {
+            fprintf(stderr, "%s\n", qPrintable(error));
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto target =
+        vectorTargetFromName(parser.value(vectorTargetOption));
+    if (!target) {
+        fprintf(stderr, "Invalid vector target: %s\n",
+                qPrintable(parser.value(vectorTargetOption)));
+        return EXIT_FAILURE;
+    }
+    setMaxVectorTarget(*target);
+
+    // Checked here for all modes, which read it with swapsOption().
+    if (parser.isSet(swaps)) {
+        bool ok;
+        const auto count = parser.value(swaps).toLongLong(&ok);
+        if (!ok || count < 0) {
+            fprintf(stderr, "Invalid number of swaps: %s\n",
+                    qPrintable(parser.value(swaps)));
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto placement = parseThreadPlacement(parser);
+    if (!placement) {
+        return EXIT_FAILURE;
+    }
+    setThreadPlacement(*placement);
+    // Headless modes sort on this thread, or on threads it starts,
+    // while the window keeps off the CPUs of the threads which sort.
+    const auto placementError = isHeadless(argc, argv)
+                                    ? applyToCurrentThread(*placement)
+                                    : excludeCurrentThread(*placement);
+    if (!placementError.isEmpty()) {
+        fprintf(stderr, "%s\n", qPrintable(placementError));
+        return EXIT_FAILURE;
+    }
+
+    if (parser.isSet("tests")) {
+        return RunTests(parser);
+    }
+
+    if (parser.isSet("benchmark")) {
+        return RunBenchmark(parser);
+    }
 
-    parser.process(app);
+    if (parser.isSet("bench-suite")) {
+        return RunBenchSuite(parser);
+    }
+
+    if (parser.isSet("calibrate")) {
+        return RunCalibration(parser);
+    }
+
+    if (parser.isSet("export")) {
+        return RunExport(parser);
+    }
 
-    if (parser.isSet(runTests)) {
-        TestAlgorithms();
-        return EXIT_SUCCESS;
+    if (parser.isSet("sort")) {
+        return RunFileSort(parser);
     }
 
     MainWindow w;
+    if (parser.isSet(cacheLevels)) {
+        const auto levels = parseCacheLevels(parser.value(cacheLevels));
+        if (!levels) {
+            fprintf(stderr, "Invalid cache levels: %s\n",
+                    qPrintable(parser.value(cacheLevels)));
+            return EXIT_FAILURE;
+        }
+        w.setCacheLevels(*levels);
+    }
+    if (parser.isSet(seed)) {
+        bool ok;
+        const auto value = parser.value(seed).toULongLong(&ok);
+        if (!ok) {
+            fprintf(stderr, "Invalid seed: %s\n",
+                    qPrintable(parser.value(seed)));
+            return EXIT_FAILURE;
+        }
+        w.setSeed(value);
+    }
+    if (const auto count = swapsOption(parser)) {
+        w.setSwaps(*count);
+    }
     w.show();
 
-    return app.exec();
+    return app->exec();
 }